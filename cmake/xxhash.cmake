@@ -0,0 +1,7 @@
+CPMAddPackage(
+        NAME xxHash
+        GITHUB_REPOSITORY Cyan4973/xxHash
+        VERSION 0.8.2
+        DOWNLOAD_ONLY YES)
+add_library(xxhash INTERFACE)
+target_include_directories(xxhash INTERFACE ${xxHash_SOURCE_DIR})
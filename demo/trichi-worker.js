@@ -8,11 +8,28 @@ import initTrichiJs from './trichi/trichi.module.min.js';
 let trichi;
 let threadPoolSize = 1;
 
+async function getTrichi() {
+    if (!trichi) {
+        trichi = await initTrichiJs(navigator.hardwareConcurrency);
+    }
+    return trichi;
+}
+
+// builds block this worker, so the main thread cancels them through the module's shared memory before sending a new asset
+// modules built before cancellation was supported don't have a cancellation token, so their builds can't be cancelled
+async function getCancellationHandle() {
+    const trichi = await getTrichi();
+    try {
+        return trichi.getCancellationHandle();
+    } catch (e) {
+        console.warn('builds can not be cancelled:', e);
+        return undefined;
+    }
+}
+
 async function processModel(file, onModelProcessed, onError) {
     try {
-        if (!trichi) {
-            trichi = await initTrichiJs(navigator.hardwareConcurrency);
-        }
+        const trichi = await getTrichi();
 
         const trichiParams = {
             maxVerticesPerCluster: 64,
@@ -27,6 +44,10 @@ async function processModel(file, onModelProcessed, onError) {
             file.bytes,
             trichiParams,
         );
+        if (mesh.aborted) {
+            onError(new Error(`processing ${file.name} was cancelled`));
+            return;
+        }
 
         const aabb = {
             min: [mesh.vertices[0], mesh.vertices[1], mesh.vertices[2]],
@@ -78,4 +99,4 @@ async function processModel(file, onModelProcessed, onError) {
     }
 }
 
-Comlink.expose(processModel);
+Comlink.expose({processModel, getCancellationHandle});
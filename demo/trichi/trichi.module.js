@@ -1,17 +1,83 @@
 /* trichi@0.1.0, license MIT */
-const threads=()=>(async e=>{try{return "undefined"!=typeof MessageChannel&&(new MessageChannel).port1.postMessage(new SharedArrayBuffer(1)),WebAssembly.validate(e)}catch(e){return !1}})(new Uint8Array([0,97,115,109,1,0,0,0,1,4,1,96,0,0,3,2,1,0,5,4,1,3,1,1,10,11,1,9,0,65,0,254,16,2,0,26,11]));
+const simd=async()=>WebAssembly.validate(new Uint8Array([0,97,115,109,1,0,0,0,1,5,1,96,0,1,123,3,2,1,0,10,10,1,8,0,65,0,253,15,253,98,11])),threads=()=>(async e=>{try{return"undefined"!=typeof MessageChannel&&(new MessageChannel).port1.postMessage(new SharedArrayBuffer(1)),WebAssembly.validate(e)}catch(e){return!1}})(new Uint8Array([0,97,115,109,1,0,0,0,1,4,1,96,0,0,3,2,1,0,5,4,1,3,1,1,10,11,1,9,0,65,0,254,16,2,0,26,11]));
 
+/**
+ * Cancels the build currently running in the {@link Trichi} module the given handle belongs to.
+ * The cancelled build returns the levels completed so far and sets {@link TriangleClusterHierarchy#aborted}.
+ *
+ * The cancellation is reset when the cancelled build returns.
+ * If no build is running, the module's next build is cancelled instead, unless the cancellation is reset using {@link resetCancellation} first.
+ *
+ * @param handle the module's cancellation handle
+ */
+function cancelBuild(handle) {
+    Atomics.store(new Uint8Array(handle.buffer), handle.byteOffset, 1);
+}
+/**
+ * Resets a cancellation that did not reach a build, e.g., because the build returned before {@link cancelBuild} was called.
+ * This must only be called while the module is not building a hierarchy.
+ *
+ * @param handle the module's cancellation handle
+ */
+function resetCancellation(handle) {
+    Atomics.store(new Uint8Array(handle.buffer), handle.byteOffset, 0);
+}
+/**
+ * Fills in the defaults of optional {@link Params}, since the WebAssembly module requires all of them to be set.
+ */
+function withDefaultParams(params) {
+    return {
+        ...params,
+        seed: params.seed ?? 0,
+        deferClusterOptimization: params.deferClusterOptimization ?? false,
+        partitionRegions: params.partitionRegions ?? 0,
+        sortClustersSpatially: params.sortClustersSpatially ?? false,
+        timeLimitMilliseconds: params.timeLimitMilliseconds ?? 0,
+        memoryBudgetBytes: params.memoryBudgetBytes ?? 0,
+    };
+}
 /**
  * Initializes a {@link Trichi} module.
  *
  * @param maxThreadPoolSize sets the maximum number of threads in the module's thread pool. In environments that do not support multithreading, this is ignored.
+ * @param features overrides the detected WebAssembly features to pick a specific module variant, e.g., for benchmarking. If `threads` is not set, it is detected. If `simd` is not set, it defaults to false.
  */
-async function initTrichiJs(maxThreadPoolSize = navigator.hardwareConcurrency) {
-    const moduleName = (await threads()) ? './wasm/trichi-wasm-threads.js' : './wasm/trichi-wasm.js';
-    const module = await import(moduleName);
+async function initTrichiJs(maxThreadPoolSize = navigator.hardwareConcurrency, features = {}) {
+    const useThreads = features.threads ?? await threads();
+    const useSimd = (features.simd ?? false) && await simd();
+    const moduleName = `./wasm/trichi-wasm${useThreads ? '-threads' : ''}`;
+    let module;
+    try {
+        module = await import(`${moduleName}${useSimd ? '-simd' : ''}.js`);
+    }
+    catch (e) {
+        if (!useSimd) {
+            throw e;
+        }
+        // the SIMD variant may not have been built, so the variant without SIMD is used instead
+        module = await import(`${moduleName}.js`);
+    }
     // @ts-expect-error we don't care if the module's type is unknown here
-    return new module.default({ maxThreads: Math.min(maxThreadPoolSize, navigator.hardwareConcurrency) });
+    const trichi = await new module.default({ maxThreads: Math.min(maxThreadPoolSize, navigator.hardwareConcurrency) });
+    return {
+        buildTriangleClusterHierarchy(indices, vertices, vertexStrideBytes, params) {
+            return trichi.buildTriangleClusterHierarchy(indices, vertices, vertexStrideBytes, withDefaultParams(params));
+        },
+        buildMultiMaterialTriangleClusterHierarchy(indices, submeshes, vertices, vertexStrideBytes, params) {
+            return trichi.buildMultiMaterialTriangleClusterHierarchy(indices, submeshes, vertices, vertexStrideBytes, withDefaultParams(params));
+        },
+        buildTriangleClusterHierarchyFromFileBlob(fileName, bytes, params) {
+            return trichi.buildTriangleClusterHierarchyFromFileBlob(fileName, bytes, withDefaultParams(params));
+        },
+        getCancellationHandle() {
+            const token = trichi.getCancellationToken();
+            if (typeof SharedArrayBuffer === 'undefined' || !(token.buffer instanceof SharedArrayBuffer)) {
+                return undefined;
+            }
+            return { buffer: token.buffer, byteOffset: token.byteOffset };
+        },
+    };
 }
 
-export { initTrichiJs as default };
+export { cancelBuild, initTrichiJs as default, resetCancellation };
 //# sourceMappingURL=trichi.module.js.map
@@ -6,7 +6,14 @@
 #ifndef TRICHI_HPP
 #define TRICHI_HPP
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace trichi {
@@ -47,13 +54,82 @@ struct Params {
    * If this is 0, defaults to 1.
    */
   size_t threadPoolSize = 1;
+
+  /**
+   * The seed for METIS' random number generator used when grouping clusters.
+   * For a given input, `Params` and build of `trichi`, the resulting hierarchy is bit-exact, independent of `threadPoolSize`.
+   */
+  uint32_t seed = 0;
+
+  /**
+   * If true, the vertex & triangle order of clusters is not optimized while the hierarchy is built but in a single parallel pass over all clusters at the end.
+   * This takes the optimization off the critical path of building each level, but since later levels are built from differently ordered triangles, the resulting hierarchy differs slightly.
+   * Levels published via a `LevelCallback` and partial hierarchies of aborted builds are optimized as well.
+   */
+  bool deferClusterOptimization = false;
+
+  /**
+   * The number of spatial regions each level's clusters are split into before they are grouped.
+   * The regions are grouped in parallel, and small groups at region borders are merged with their neighbors afterward.
+   * This makes grouping large levels scale with `threadPoolSize` at the cost of slightly worse groups along region borders.
+   * Levels with too few clusters are not split. If this is 0 or 1, each level is grouped as a whole.
+   */
+  size_t partitionRegions = 0;
+
+  /**
+   * If true, the clusters of each level are sorted by the Morton code of their bounds' centers, so that spatially close clusters are also close in memory.
+   * This improves the memory locality of grouping the next level and of culling clusters at runtime, but changes the order in which clusters are grouped.
+   */
+  bool sortClustersSpatially = false;
+
+  /**
+   * If this is not null, the build is aborted as soon as possible after the pointed to value becomes true.
+   * The token is checked between hierarchy levels and before each cluster group is processed.
+   */
+  const std::atomic_bool* cancellationToken = nullptr;
+
+  /**
+   * The maximum time in milliseconds building the hierarchy may take before it is aborted.
+   * If this is 0, there is no time limit.
+   */
+  size_t timeLimitMilliseconds = 0;
+
+  /**
+   * The maximum (estimated) number of bytes the hierarchy may occupy before the build is aborted.
+   * If this is 0, there is no memory budget.
+   */
+  size_t memoryBudgetBytes = 0;
+};
+
+/**
+ * A range of triangles in an index buffer that share a material.
+ *
+ * Clusters never mix materials, but clusters of different submeshes may be grouped and simplified together.
+ * Submeshes with the same material may share clusters.
+ */
+struct Submesh {
+  /**
+   * The offset of the submesh's first index in the index buffer.
+   */
+  size_t firstIndex = 0;
+
+  /**
+   * The number of indices in the submesh.
+   * Must be a multiple of 3.
+   */
+  size_t indexCount = 0;
+
+  /**
+   * The id of the submesh's material.
+   */
+  uint32_t materialId = 0;
 };
 
 /**
  * A cluster group's bounding sphere and simplification error.
  *
  * A cluster group's error bounds conservatively bound all its child groups.
- * It is not a tight bound of the cluster's / cluster group's vertices and is suboptimal for frustum culling.
+ * It is not a tight bound of the cluster's / cluster group's vertices and is suboptimal for frustum culling (see `GroupBounds`).
  */
 struct ErrorBounds {
   /**
@@ -70,6 +146,8 @@ struct ErrorBounds {
    * The cluster's absolute simplification error.
    */
   float error = 0.0;
+
+  bool operator==(const ErrorBounds&) const = default;
 };
 
 /**
@@ -91,6 +169,8 @@ struct NormalCone {
    * If this is >= 1, the cluster cone does not contain any useful information and the cluster should be treated as if containing both back and front facing triangles.
    */
   float cutoff = 1.0;
+
+  bool operator==(const NormalCone&) const = default;
 };
 
 /**
@@ -109,6 +189,8 @@ struct NodeErrorBounds {
    * The cluster's error bounds.
    */
   ErrorBounds clusterError{};
+
+  bool operator==(const NodeErrorBounds&) const = default;
 };
 
 struct ClusterBounds {
@@ -126,6 +208,41 @@ struct ClusterBounds {
    * The cluster's normal cone.
    */
   NormalCone normalCone{};
+
+  bool operator==(const ClusterBounds&) const = default;
+};
+
+/**
+ * Tight bounds of a cluster group, i.e., of all children of the nodes created from the same group.
+ * Used for culling a group of clusters as a whole before testing its individual clusters.
+ */
+struct GroupBounds {
+  /**
+   * The minimum corner of the group's axis-aligned bounding box.
+   */
+  float aabbMin[3]{};
+
+  /**
+   * The maximum corner of the group's axis-aligned bounding box.
+   */
+  float aabbMax[3]{};
+
+  /**
+   * The bounding sphere's center.
+   */
+  float center[3]{};
+
+  /**
+   * The bounding sphere's radius.
+   */
+  float radius{};
+
+  /**
+   * The normal cone of all the group's triangles.
+   */
+  NormalCone normalCone{};
+
+  bool operator==(const GroupBounds&) const = default;
 };
 
 /**
@@ -143,6 +260,15 @@ struct Node {
    * The indices of the node's children.
    */
   std::vector<size_t> childNodeIndices{};
+
+  /**
+   * The index of the bounds of the node's children in `ClusterHierarchy::groupBounds`.
+   * All nodes created from the same cluster group share the same children and bounds.
+   * Only meaningful if the node has children.
+   */
+  size_t childGroupIndex = 0;
+
+  bool operator==(const Node&) const = default;
 };
 
 /**
@@ -170,6 +296,8 @@ struct Cluster {
    * The number of triangles in the cluster.
    */
   unsigned int triangleCount = 0;
+
+  bool operator==(const Cluster&) const = default;
 };
 
 /**
@@ -208,6 +336,12 @@ struct ClusterHierarchy {
    */
   std::vector<ClusterBounds> bounds{};
 
+  /**
+   * Tight bounds of cluster groups (see `Node::childGroupIndex`).
+   * Used for hierarchical culling.
+   */
+  std::vector<GroupBounds> groupBounds{};
+
   /**
    * Clusters in the hierarchy.
    */
@@ -228,6 +362,155 @@ struct ClusterHierarchy {
    *    triangles[c.triangle_offset], triangles[c.triangle_offset + c.triangle_count * 3]
    */
   std::vector<uint8_t> triangles{};
+
+  /**
+   * The material id of each cluster in the hierarchy (see `Submesh::materialId`).
+   * A cluster's triangles all belong to submeshes with this material.
+   */
+  std::vector<uint32_t> materials{};
+
+  bool operator==(const ClusterHierarchy&) const = default;
+};
+
+/**
+ * The clusters added to a `ClusterHierarchy` by one level of the build.
+ *
+ * All indices and offsets refer to the complete hierarchy, i.e., the level's arrays can be appended to the arrays of previously published levels as is.
+ */
+struct ClusterHierarchyLevel {
+  /**
+   * The level's index, where 0 is the level of the original high resolution clusters.
+   */
+  size_t level = 0;
+
+  /**
+   * The index of the level's first node (and cluster) in the hierarchy.
+   */
+  size_t firstNode = 0;
+
+  /**
+   * The index of the level's first group in `ClusterHierarchy::groupBounds`.
+   */
+  size_t firstGroup = 0;
+
+  /**
+   * The offset of the level's first vertex index in `ClusterHierarchy::vertices`.
+   */
+  size_t vertexOffset = 0;
+
+  /**
+   * The offset of the level's first triangle in `ClusterHierarchy::triangles`.
+   */
+  size_t triangleOffset = 0;
+
+  /**
+   * The level's nodes.
+   */
+  std::vector<Node> nodes{};
+
+  /**
+   * The error bounds of the level's clusters.
+   * Their parent error bounds are only known once the next level has been built (see `updatedNodes`).
+   */
+  std::vector<NodeErrorBounds> errors{};
+
+  /**
+   * The bounds of the level's clusters.
+   */
+  std::vector<ClusterBounds> bounds{};
+
+  /**
+   * The bounds of the cluster groups the level's clusters were created from.
+   */
+  std::vector<GroupBounds> groupBounds{};
+
+  /**
+   * The level's clusters.
+   */
+  std::vector<Cluster> clusters{};
+
+  /**
+   * The vertex indices of the level's clusters.
+   */
+  std::vector<uint32_t> vertices{};
+
+  /**
+   * The triangles of the level's clusters.
+   */
+  std::vector<uint8_t> triangles{};
+
+  /**
+   * The material ids of the level's clusters.
+   */
+  std::vector<uint32_t> materials{};
+
+  /**
+   * Indices of nodes of previous levels that became children of this level's nodes.
+   */
+  std::vector<size_t> updatedNodes{};
+
+  /**
+   * The new parent error bounds of the nodes in `updatedNodes`.
+   */
+  std::vector<ErrorBounds> updatedParentErrors{};
+};
+
+/**
+ * Called whenever a level of the cluster hierarchy has been completed.
+ * The callback is invoked on the thread building the hierarchy and blocks the build until it returns.
+ */
+using LevelCallback = std::function<void(const ClusterHierarchyLevel&)>;
+
+/**
+ * The reason a build was aborted.
+ */
+enum class AbortReason {
+  /**
+   * `Params::cancellationToken` was set.
+   */
+  Cancelled,
+
+  /**
+   * `Params::timeLimitMilliseconds` was exceeded.
+   */
+  TimeLimitExceeded,
+
+  /**
+   * `Params::memoryBudgetBytes` was exceeded.
+   */
+  MemoryBudgetExceeded,
+};
+
+/**
+ * Thrown by `buildClusterHierarchy` if the build was aborted (see `Params::cancellationToken`).
+ *
+ * Carries the partial hierarchy consisting of all levels that were completed before the build was aborted.
+ * The clusters of the last completed level are the partial hierarchy's root nodes.
+ * If the build was aborted before the clusters of level 0 were built, the partial hierarchy is empty.
+ */
+class BuildAbortedError : public std::runtime_error {
+ public:
+  BuildAbortedError(const AbortReason reason, ClusterHierarchy partialHierarchy)
+      : std::runtime_error(
+            reason == AbortReason::Cancelled           ? "cluster hierarchy build cancelled"
+            : reason == AbortReason::TimeLimitExceeded ? "cluster hierarchy build exceeded its time limit"
+                                                       : "cluster hierarchy build exceeded its memory budget"),
+        abortReason(reason),
+        hierarchy(std::make_shared<ClusterHierarchy>(std::move(partialHierarchy))) {}
+
+  /**
+   * @return Returns the reason the build was aborted.
+   */
+  [[nodiscard]] AbortReason reason() const { return abortReason; }
+
+  /**
+   * @return Returns the levels of the hierarchy that were completed before the build was aborted.
+   */
+  [[nodiscard]] const ClusterHierarchy& partialHierarchy() const { return *hierarchy; }
+
+ private:
+  AbortReason abortReason;
+  std::shared_ptr<ClusterHierarchy> hierarchy;
 };
 
 /**
@@ -241,8 +524,1069 @@ struct ClusterHierarchy {
  * @param vertexStride the size of each vertex in the vertices array
  * @param params tuning parameters for building the cluster hierarchy
  * @return Returns the triangle cluster hierarchy built for the input mesh.
+ * @throws BuildAbortedError if the build was cancelled or exceeded its time limit or memory budget.
  */
 [[nodiscard]] ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {});
+
+/**
+ * Builds a cluster hierarchy for a given triangle mesh and publishes each level as soon as it has been completed.
+ * See `buildClusterHierarchy` for details.
+ *
+ * @param indices the input meshes vertex indices
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @param onLevelCompleted called with each completed level, starting at level 0
+ * @return Returns the triangle cluster hierarchy built for the input mesh.
+ * @throws BuildAbortedError if the build was cancelled or exceeded its time limit or memory budget.
+ */
+[[nodiscard]] ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t vertexStride, const Params& params, const LevelCallback& onLevelCompleted);
+
+/**
+ * Builds a single cluster hierarchy for a triangle mesh consisting of multiple submeshes with different materials.
+ * See `buildClusterHierarchy` for details.
+ *
+ * Clusters never mix materials: the triangles of each material are clustered separately and the borders between materials are preserved during simplification.
+ * Cluster groups are formed across submeshes and materials, so that there are no wasted clusters at material seams.
+ * Indices not covered by any submesh are ignored.
+ *
+ * @param indices the input meshes vertex indices
+ * @param submeshes ranges of `indices` and their materials
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @param onLevelCompleted if set, called with each completed level, starting at level 0
+ * @return Returns the triangle cluster hierarchy built for the input mesh, with each cluster's material in `ClusterHierarchy::materials`.
+ * @throws BuildAbortedError if the build was cancelled or exceeded its time limit or memory budget.
+ */
+[[nodiscard]] ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {}, const LevelCallback& onLevelCompleted = {});
+
+/**
+ * Builds a cluster hierarchy for a given triangle mesh on a separate thread.
+ * See `buildClusterHierarchy` for details.
+ *
+ * Completed levels are published via `onLevelCompleted` on the build thread while coarser levels are still being built.
+ * A `BuildAbortedError` is propagated via the returned future.
+ *
+ * @param indices the input meshes vertex indices
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @param onLevelCompleted if set, called with each completed level, starting at level 0
+ * @return Returns a future holding the triangle cluster hierarchy built for the input mesh.
+ */
+[[nodiscard]] std::future<ClusterHierarchy> buildClusterHierarchyAsync(std::vector<uint32_t> indices, std::vector<float> vertices, size_t vertexStride, Params params = {}, LevelCallback onLevelCompleted = {});
+
+/**
+ * Updates a cluster hierarchy after some of its input mesh's vertices have been moved, e.g., by sculpting a small region of the mesh.
+ *
+ * Only the parts of the hierarchy that depend on a changed vertex are rebuilt:
+ * clusters without children that use a changed vertex keep their triangles but get new bounds, and all of their ancestors are discarded.
+ * The affected clusters and the remaining children of discarded clusters are then grouped & simplified level by level like in `buildClusterHierarchy`.
+ * New clusters are appended to the hierarchy.
+ *
+ * All other clusters keep their index and data, including their offsets into the vertex & triangle arrays, so that untouched subtrees stay valid.
+ * Discarded clusters keep their index as well, but they are emptied: they have no triangles, no children, and an infinite error, so they are never selected.
+ * Their slots are only reclaimed by building the hierarchy from scratch, and their vertices & triangles are left in place until the hierarchy is compacted (see `compactClusterHierarchy`).
+ *
+ * Only vertex positions may change, i.e., the input mesh's indices must be the ones the hierarchy was built from.
+ * Edits that change the mesh's topology require a full rebuild.
+ *
+ * @param hierarchy the hierarchy built for the input mesh before its vertices were changed
+ * @param vertices the input mesh's changed vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param changedVertices the indices of all vertices that have changed
+ * @param params the parameters the hierarchy was built with
+ * @return Returns the updated cluster hierarchy.
+ */
+[[nodiscard]] ClusterHierarchy updateClusterHierarchy(ClusterHierarchy hierarchy, const std::vector<float>& vertices, size_t vertexStride, const std::vector<uint32_t>& changedVertices, const Params& params = {});
+
+/**
+ * Removes vertex & triangle data that is not used by any cluster, e.g., the data left behind by clusters discarded in `updateClusterHierarchy`.
+ *
+ * Clusters keep their index, but their data is stored contiguously in cluster order afterward, so their offsets into the vertex & triangle arrays change.
+ *
+ * @param hierarchy the hierarchy to compact
+ * @return Returns the compacted cluster hierarchy.
+ */
+[[nodiscard]] ClusterHierarchy compactClusterHierarchy(ClusterHierarchy hierarchy);
+
+/**
+ * Merges cluster hierarchies that were built separately for parts of a larger mesh, e.g., the tiles of a terrain or the blocks of a city, into one hierarchy with shared coarse levels.
+ *
+ * The hierarchies are concatenated in order: each keeps its clusters, nodes & groups, offset by those of all previous hierarchies, so that their fine levels stay untouched.
+ * The roots of all hierarchies are then grouped & simplified level by level like in `buildClusterHierarchy`, joining on the level they were built on, and the new clusters are appended.
+ * Instead of drawing each part's roots, distant views can then draw a few clusters covering all parts.
+ *
+ * All hierarchies must index into the same vertex array, and neighbouring parts should share the vertices on their common border:
+ * shared vertices connect neighbouring roots, so that they are grouped together and the borders between them can be simplified.
+ *
+ * @param hierarchies the hierarchies to merge
+ * @param vertices the vertices all hierarchies index into - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the shared levels, usually the ones the hierarchies were built with
+ * @return Returns the merged cluster hierarchy.
+ */
+[[nodiscard]] ClusterHierarchy mergeClusterHierarchies(const std::vector<ClusterHierarchy>& hierarchies, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {});
+
+/**
+ * Serializes a cluster hierarchy to trichi's binary format.
+ *
+ * The format stores all arrays of the hierarchy in native byte order and is not meant to be exchanged between platforms with different endianness.
+ *
+ * @param hierarchy the cluster hierarchy to serialize
+ * @return Returns the serialized cluster hierarchy.
+ */
+[[nodiscard]] std::vector<uint8_t> serializeClusterHierarchy(const ClusterHierarchy& hierarchy);
+
+/**
+ * Deserializes a cluster hierarchy from trichi's binary format.
+ *
+ * Throws a `std::runtime_error` if the data is not a valid serialized cluster hierarchy.
+ * This includes hierarchies whose node, cluster, vertex or triangle indices are out of range.
+ *
+ * @param data the serialized cluster hierarchy
+ * @param size the size of the serialized cluster hierarchy in bytes
+ * @return Returns the deserialized cluster hierarchy.
+ */
+[[nodiscard]] ClusterHierarchy deserializeClusterHierarchy(const uint8_t* data, size_t size);
+
+/**
+ * Statistics of an on-disk cluster hierarchy cache.
+ * The counters may be shared by concurrent builds.
+ */
+struct CacheStatistics {
+  /**
+   * The number of builds that were served from the cache.
+   */
+  std::atomic_size_t hits = 0;
+
+  /**
+   * The number of builds that were not found in the cache (or found but invalid) and had to be built.
+   */
+  std::atomic_size_t misses = 0;
+
+  /**
+   * The number of bytes loaded from the cache.
+   */
+  std::atomic_size_t bytesRead = 0;
+
+  /**
+   * The number of bytes written to the cache.
+   */
+  std::atomic_size_t bytesWritten = 0;
+
+  /**
+   * The number of built hierarchies that could not be written to the cache.
+   * These builds are still returned.
+   */
+  std::atomic_size_t writeFailures = 0;
+};
+
+/**
+ * Parameters for caching cluster hierarchies on disk.
+ */
+struct CacheParams {
+  /**
+   * The directory cached hierarchies are stored in.
+   * It is created if it does not exist.
+   */
+  std::string directory{};
+
+  /**
+   * If not null, cache hits and misses are recorded here.
+   */
+  CacheStatistics* statistics = nullptr;
+};
+
+/**
+ * Computes the key under which the cluster hierarchy for the given input is cached.
+ *
+ * The key is a hash of the input's indices, vertex positions, vertex stride, and all `Params` that affect the result.
+ * Other vertex attributes and `Params::threadPoolSize` are ignored.
+ *
+ * @param indices the input meshes vertex indices
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @return Returns the cache key for the given input.
+ */
+[[nodiscard]] uint64_t computeCacheKey(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {});
+
+/**
+ * Computes the key under which the cluster hierarchy for the given input with multiple submeshes is cached.
+ * See `computeCacheKey` for details.
+ *
+ * @param indices the input meshes vertex indices
+ * @param submeshes ranges of `indices` and their materials
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @return Returns the cache key for the given input.
+ */
+[[nodiscard]] uint64_t computeCacheKey(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {});
+
+/**
+ * Builds a cluster hierarchy for a given triangle mesh or loads it from an on-disk cache if it has been built before.
+ *
+ * Newly built hierarchies are added to the cache.
+ * If a hierarchy can't be added, it is still returned and counted in `CacheStatistics::writeFailures`.
+ * See `buildClusterHierarchy` for details.
+ *
+ * @param indices the input meshes vertex indices
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @param cacheParams the cache's location and statistics
+ * @return Returns the triangle cluster hierarchy built for the input mesh.
+ */
+[[nodiscard]] ClusterHierarchy buildClusterHierarchyCached(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t vertexStride, const Params& params, const CacheParams& cacheParams);
+
+/**
+ * Builds a cluster hierarchy for a given triangle mesh with multiple submeshes or loads it from an on-disk cache if it has been built before.
+ * See `buildClusterHierarchyCached` for details.
+ *
+ * @param indices the input meshes vertex indices
+ * @param submeshes ranges of `indices` and their materials
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchy
+ * @param cacheParams the cache's location and statistics
+ * @return Returns the triangle cluster hierarchy built for the input mesh.
+ */
+[[nodiscard]] ClusterHierarchy buildClusterHierarchyCached(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, size_t vertexStride, const Params& params, const CacheParams& cacheParams);
+
+/**
+ * The maximum number of children of an inner BVH node.
+ * This is also the maximum number of clusters in a BVH leaf, unless a single cluster group produced more clusters.
+ */
+constexpr size_t kBvhWidth = 8;
+
+/**
+ * A node in a `ClusterBvh`.
+ */
+struct BvhNode {
+  /**
+   * The center of a sphere bounding all clusters below the node.
+   */
+  float center[3]{};
+
+  /**
+   * The radius of a sphere bounding all clusters below the node.
+   */
+  float radius{};
+
+  /**
+   * Conservatively bounds the parent error bounds of all clusters below the node.
+   * If the error projected with these bounds is below the threshold for a view, none of the clusters below the node can be selected for that view.
+   */
+  ErrorBounds maxParentError{};
+
+  /**
+   * For inner nodes, the index of the node's first child in `ClusterBvh::nodes`.
+   * For leaves, the offset of the node's first cluster in `ClusterBvh::clusterIndices`.
+   */
+  uint32_t firstChild = 0;
+
+  /**
+   * The number of child nodes of an inner node or the number of clusters in a leaf.
+   */
+  uint32_t childCount = 0;
+
+  /**
+   * True if the node is a leaf, i.e., references clusters instead of child nodes.
+   */
+  bool isLeaf = false;
+
+  bool operator==(const BvhNode&) const = default;
+};
+
+/**
+ * A bounding volume hierarchy over the clusters of a `ClusterHierarchy`.
+ *
+ * Each LOD level of the cluster hierarchy has its own subtree, in which clusters created from the same cluster group are kept in the same leaf.
+ * Culling and LOD selection can skip whole subtrees, so their cost scales with the number of visible clusters instead of the total number of clusters.
+ */
+struct ClusterBvh {
+  /**
+   * The BVH's nodes, where `nodes[0]` is the root.
+   * The children of an inner node are stored contiguously.
+   */
+  std::vector<BvhNode> nodes{};
+
+  /**
+   * The cluster indices referenced by the BVH's leaves.
+   */
+  std::vector<size_t> clusterIndices{};
+
+  bool operator==(const ClusterBvh&) const = default;
+};
+
+/**
+ * Builds a BVH over the clusters of a cluster hierarchy.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @return Returns the BVH, which is empty if the hierarchy does not contain any clusters.
+ */
+[[nodiscard]] ClusterBvh buildClusterBvh(const ClusterHierarchy& hierarchy);
+
+/**
+ * Traverses a BVH depth-first.
+ *
+ * @param bvh the BVH to traverse
+ * @param visitNode called for each reached node - the node's children are only traversed if this returns true
+ * @param visitCluster called for each cluster in a reached leaf whose `visitNode` returned true
+ */
+void traverseClusterBvh(const ClusterBvh& bvh, const std::function<bool(const BvhNode&)>& visitNode, const std::function<void(size_t)>& visitCluster);
+
+/**
+ * The view for which `selectClusters` selects clusters.
+ */
+struct ViewParams {
+  /**
+   * The camera's position.
+   */
+  float cameraPosition[3]{};
+
+  /**
+   * Scales errors projected to the view, e.g., `0.5 * viewportHeight / tan(0.5 * verticalFov)` to measure errors in pixels.
+   */
+  float projectionScale = 1.0;
+
+  /**
+   * The maximum projected error of a selected cluster.
+   */
+  float errorThreshold = 1.0;
+
+  /**
+   * Planes as (normal, distance), where points p with `dot(normal, p) + distance < 0` are outside the view.
+   * If this is empty, clusters are not culled.
+   */
+  std::vector<std::array<float, 4>> cullingPlanes{};
+};
+
+/**
+ * Selects the clusters to render for a view using a `ClusterBvh`.
+ *
+ * A cluster is selected if its own projected error is within `ViewParams::errorThreshold` but its parent group's is not, and if it is not outside the view's culling planes.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @param bvh the BVH built for the cluster hierarchy
+ * @param view the view to select clusters for
+ * @return Returns the indices of the selected clusters.
+ */
+[[nodiscard]] std::vector<size_t> selectClusters(const ClusterHierarchy& hierarchy, const ClusterBvh& bvh, const ViewParams& view);
+
+/**
+ * Parameters for extracting a mesh from a cluster hierarchy.
+ */
+struct ExtractionParams {
+  /**
+   * If true, the extracted mesh's indices refer to a compact vertex list (see `ExtractedMesh::vertices`) instead of the original vertex buffer.
+   */
+  bool compactVertices = true;
+
+  /**
+   * If true, the triangle range of each extracted cluster is emitted (see `ExtractedMesh::clusterRanges`), e.g., to build acceleration structures per cluster.
+   */
+  bool emitClusterRanges = false;
+
+  /**
+   * The number of threads used to extract the mesh.
+   * This is only used if trichi is built with TRICHI_PARALLEL enabled.
+   */
+  size_t threadPoolSize = 1;
+};
+
+/**
+ * The range of triangles an extracted cluster occupies in an `ExtractedMesh`.
+ */
+struct ClusterRange {
+  /**
+   * The index of the cluster in the cluster hierarchy.
+   */
+  size_t clusterIndex = 0;
+
+  /**
+   * The index of the cluster's first triangle in `ExtractedMesh::indices`, i.e., its first index is at `3 * firstTriangle`.
+   */
+  size_t firstTriangle = 0;
+
+  /**
+   * The number of triangles in the cluster.
+   */
+  size_t triangleCount = 0;
+
+  bool operator==(const ClusterRange&) const = default;
+};
+
+/**
+ * A plain indexed triangle mesh extracted from a cut through a cluster hierarchy.
+ */
+struct ExtractedMesh {
+  /**
+   * The extracted triangles' indices.
+   * If `ExtractionParams::compactVertices` is set, these index into `vertices`, otherwise they index into the original vertex buffer.
+   */
+  std::vector<uint32_t> indices{};
+
+  /**
+   * The original vertex index of each vertex referenced by `indices` in order of first use.
+   * This is empty if `ExtractionParams::compactVertices` is not set.
+   */
+  std::vector<uint32_t> vertices{};
+
+  /**
+   * The triangle range of each extracted cluster in the order the clusters were extracted.
+   * This is empty if `ExtractionParams::emitClusterRanges` is not set.
+   */
+  std::vector<ClusterRange> clusterRanges{};
+
+  bool operator==(const ExtractedMesh&) const = default;
+};
+
+/**
+ * Extracts the triangles of the given clusters as a single mesh.
+ * Since all clusters in a cluster hierarchy index into the original vertex buffer, the extracted mesh is welded, i.e., vertices shared by adjacent clusters are only referenced once.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @param clusterIndices the clusters to extract, e.g., as returned by `selectClusters`
+ * @param params the extraction parameters
+ * @return Returns the extracted mesh.
+ */
+[[nodiscard]] ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, const std::vector<size_t>& clusterIndices, const ExtractionParams& params = {});
+
+/**
+ * Extracts a view-independent cut through a cluster hierarchy as a single mesh, e.g., for building a ray tracing acceleration structure.
+ * A cluster is part of the cut if its own error is at most `maxError` but its parent group's is not.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @param maxError the maximum (object space) simplification error of an extracted cluster
+ * @param params the extraction parameters
+ * @return Returns the extracted mesh.
+ */
+[[nodiscard]] ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, float maxError, const ExtractionParams& params = {});
+
+/**
+ * Extracts the clusters selected for a view as a single mesh.
+ * Clusters are selected like `selectClusters` selects them, but without requiring a `ClusterBvh`.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @param view the view to extract clusters for
+ * @param params the extraction parameters
+ * @return Returns the extracted mesh.
+ */
+[[nodiscard]] ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, const ViewParams& view, const ExtractionParams& params = {});
+
+/**
+ * The policy for choosing which page to evict when a streaming pool is full.
+ */
+enum class EvictionPolicy {
+  /**
+   * Evicts the page that was required least recently.
+   */
+  LeastRecentlyUsed,
+
+  /**
+   * Evicts the page that was streamed in first.
+   */
+  FirstInFirstOut,
+
+  /**
+   * Evicts the page with the most detailed clusters first, keeping coarse fallbacks resident for as long as possible.
+   * Ties are broken by evicting the page that was required least recently.
+   */
+  FinestLevelFirst,
+};
+
+/**
+ * Parameters for simulating the streaming of a cluster hierarchy along a camera path.
+ */
+struct StreamingParams {
+  /**
+   * The size of a streaming page in bytes.
+   * Clusters created from the same cluster group are always stored in the same page(s) and pages are filled in the order of the hierarchy's clusters.
+   * A group that is larger than a page occupies multiple consecutive pages.
+   */
+  size_t pageSizeBytes = 128 * 1024;
+
+  /**
+   * The size of the streaming pool in bytes, i.e., the maximum number of bytes that can be resident at the same time.
+   */
+  size_t poolSizeBytes = 64 * 1024 * 1024;
+
+  /**
+   * The maximum number of bytes that can be streamed in per frame.
+   * At least one page is streamed per frame, even if it is larger than this.
+   * If this is 0, the number of bytes streamed per frame is not limited.
+   */
+  size_t maxBytesStreamedPerFrame = 0;
+
+  /**
+   * The size of a vertex in bytes.
+   * A cluster occupies `vertexCount * vertexSizeBytes + triangleCount * 3` bytes in a page.
+   */
+  size_t vertexSizeBytes = 6 * sizeof(float);
+
+  /**
+   * The policy for choosing which page to evict when the pool is full.
+   */
+  EvictionPolicy evictionPolicy = EvictionPolicy::LeastRecentlyUsed;
+
+  /**
+   * If true, the pages containing the hierarchy's root clusters are streamed in before the first frame and never evicted, so that there is always a fallback to render.
+   */
+  bool pinRootPages = true;
+};
+
+/**
+ * The statistics of a single frame of a streaming simulation.
+ */
+struct StreamingFrameStatistics {
+  /**
+   * The number of clusters selected for the frame, assuming all clusters were resident.
+   */
+  size_t selectedClusters = 0;
+
+  /**
+   * The number of selected clusters that were not resident at the start of the frame, i.e., that had to be replaced by coarser clusters.
+   */
+  size_t missingClusters = 0;
+
+  /**
+   * The number of pages containing the selected clusters.
+   */
+  size_t requiredPages = 0;
+
+  /**
+   * The number of bytes of all pages containing the selected clusters.
+   */
+  size_t workingSetBytes = 0;
+
+  /**
+   * The number of required pages that were not resident at the start of the frame.
+   */
+  size_t pageFaults = 0;
+
+  /**
+   * The number of pages streamed in during the frame.
+   * This is less than `pageFaults` if the per-frame streaming budget was exceeded or the pool could not hold the frame's working set.
+   */
+  size_t pagesStreamed = 0;
+
+  /**
+   * The number of bytes streamed in during the frame.
+   */
+  size_t bytesStreamed = 0;
+
+  /**
+   * The number of pages evicted during the frame.
+   */
+  size_t pagesEvicted = 0;
+
+  /**
+   * The number of bytes resident at the end of the frame.
+   */
+  size_t residentBytes = 0;
+
+  bool operator==(const StreamingFrameStatistics&) const = default;
+};
+
+/**
+ * The result of a streaming simulation.
+ */
+struct StreamingReport {
+  /**
+   * The number of pages the hierarchy was split into.
+   */
+  size_t numPages = 0;
+
+  /**
+   * The number of bytes of all pages.
+   */
+  size_t totalBytes = 0;
+
+  /**
+   * The number of bytes of all pinned pages (see `StreamingParams::pinRootPages`).
+   */
+  size_t pinnedBytes = 0;
+
+  /**
+   * The statistics of each frame of the camera path.
+   */
+  std::vector<StreamingFrameStatistics> frames{};
+
+  /**
+   * The largest working set of all frames in bytes.
+   */
+  size_t peakWorkingSetBytes = 0;
+
+  /**
+   * The number of page faults over all frames.
+   */
+  size_t totalPageFaults = 0;
+
+  /**
+   * The number of bytes streamed in over all frames.
+   */
+  size_t totalBytesStreamed = 0;
+
+  bool operator==(const StreamingReport&) const = default;
+};
+
+/**
+ * Simulates streaming a cluster hierarchy along a camera path.
+ *
+ * In each frame, clusters are selected for the frame's view (see `selectClusters`) as if all clusters were resident.
+ * The pages containing the selected clusters are then requested, and missing pages are streamed in, evicting pages that are not required by the current frame according to the eviction policy.
+ * Pages streamed in during a frame are available from the next frame on.
+ *
+ * @param hierarchy the cluster hierarchy
+ * @param cameraPath the views of all frames in order, e.g., recorded from an application or generated procedurally
+ * @param params the streaming parameters
+ * @return Returns the statistics of the simulation.
+ * @throws std::runtime_error if the pinned pages do not fit into the streaming pool.
+ */
+[[nodiscard]] StreamingReport simulateStreaming(const ClusterHierarchy& hierarchy, const std::vector<ViewParams>& cameraPath, const StreamingParams& params = {});
+
+/**
+ * Parameters for analyzing a cluster hierarchy.
+ */
+struct AnalysisParams {
+  /**
+   * The maximum number of triangles per cluster the hierarchy was built with (see `Params::maxTrianglesPerCluster`).
+   * A cluster's fill rate is its number of triangles divided by this.
+   */
+  size_t maxTrianglesPerCluster = 128;
+
+  /**
+   * Clusters with a fill rate below this are counted as underfilled.
+   */
+  float underfilledThreshold = 0.5;
+
+  /**
+   * The number of threads used to analyze the hierarchy.
+   * This is only used if trichi is built with TRICHI_PARALLEL enabled.
+   */
+  size_t threadPoolSize = 1;
+};
+
+/**
+ * The analysis of a single level of a cluster hierarchy.
+ * A node's level is one more than its highest child's, where nodes without children are on level 0.
+ */
+struct LevelAnalysis {
+  /**
+   * The number of clusters on the level.
+   */
+  size_t numClusters = 0;
+
+  /**
+   * The number of triangles of all clusters on the level.
+   */
+  size_t numTriangles = 0;
+
+  /**
+   * The number of vertex indices of all clusters on the level.
+   */
+  size_t numVertices = 0;
+
+  /**
+   * The number of triangles on the level divided by the number of triangles on the previous level, or 1 for the first level.
+   */
+  float triangleReduction = 1.0;
+
+  /**
+   * The mean fill rate of the level's clusters (see `AnalysisParams::maxTrianglesPerCluster`).
+   */
+  float meanFillRate = 0.0;
+
+  /**
+   * The lowest fill rate of the level's clusters.
+   */
+  float minFillRate = 0.0;
+
+  /**
+   * The number of clusters with a fill rate below `AnalysisParams::underfilledThreshold`.
+   */
+  size_t numUnderfilledClusters = 0;
+
+  /**
+   * The mean ratio of boundary edges, i.e., edges that belong to only one of a cluster's triangles, to all edges of a cluster.
+   * Lower ratios mean more compact clusters that share fewer vertices with their neighbors.
+   */
+  float meanBoundaryEdgeRatio = 0.0;
+
+  /**
+   * The lowest simplification error of the level's clusters.
+   */
+  float minError = 0.0;
+
+  /**
+   * The highest simplification error of the level's clusters.
+   */
+  float maxError = 0.0;
+
+  /**
+   * The number of clusters whose error is greater than their parent group's error or lower than one of their children's errors.
+   * Such clusters can lead to holes or overlaps when selecting clusters for a view.
+   */
+  size_t errorMonotonicityViolations = 0;
+
+  /**
+   * The number of bytes the level occupies in a `ClusterHierarchy`, i.e., its clusters, vertex indices, triangles, error bounds and bounds.
+   */
+  size_t memoryBytes = 0;
+
+  bool operator==(const LevelAnalysis&) const = default;
+};
+
+/**
+ * The analysis of a cluster hierarchy.
+ */
+struct HierarchyAnalysis {
+  /**
+   * The number of clusters in the hierarchy.
+   */
+  size_t numClusters = 0;
+
+  /**
+   * The number of triangles of all clusters in the hierarchy.
+   */
+  size_t numTriangles = 0;
+
+  /**
+   * The number of root nodes in the hierarchy.
+   */
+  size_t numRoots = 0;
+
+  /**
+   * The number of levels in the hierarchy.
+   */
+  size_t depth = 0;
+
+  /**
+   * The mean fill rate of all clusters in the hierarchy.
+   */
+  float meanFillRate = 0.0;
+
+  /**
+   * The number of underfilled clusters in the hierarchy.
+   */
+  size_t numUnderfilledClusters = 0;
+
+  /**
+   * The number of clusters violating error monotonicity in the hierarchy.
+   */
+  size_t errorMonotonicityViolations = 0;
+
+  /**
+   * The number of bytes of all levels.
+   */
+  size_t memoryBytes = 0;
+
+  /**
+   * The analysis of each level, starting at the most detailed one.
+   */
+  std::vector<LevelAnalysis> levels{};
+
+  bool operator==(const HierarchyAnalysis&) const = default;
+};
+
+/**
+ * Analyzes the quality & cost of a cluster hierarchy, e.g., to compare different `Params`.
+ *
+ * @param hierarchy the cluster hierarchy to analyze
+ * @param params the analysis parameters
+ * @return Returns the analysis.
+ */
+[[nodiscard]] HierarchyAnalysis analyzeClusterHierarchy(const ClusterHierarchy& hierarchy, const AnalysisParams& params = {});
+
+/**
+ * Formats a hierarchy analysis as a JSON object.
+ *
+ * @param analysis the analysis to format
+ * @return Returns the JSON string.
+ */
+[[nodiscard]] std::string toJson(const HierarchyAnalysis& analysis);
+
+/**
+ * A cluster size, i.e., a pair of `Params::maxVerticesPerCluster` & `Params::maxTrianglesPerCluster`.
+ */
+struct ClusterSize {
+  size_t maxVertices = 64;
+  size_t maxTriangles = 128;
+
+  bool operator==(const ClusterSize&) const = default;
+};
+
+/**
+ * Parameters for automatically choosing `Params` for an input mesh.
+ *
+ * Each combination of the candidate cluster sizes, group sizes and cone weights is built on a representative sample of the input and scored by a cost model.
+ * The model combines the build time with the number of triangles and clusters rendered at a set of reference errors.
+ */
+struct AutotuneParams {
+  /**
+   * The candidate cluster sizes.
+   */
+  std::vector<ClusterSize> clusterSizes = {{64, 64}, {64, 124}, {64, 128}, {128, 128}, {128, 256}};
+
+  /**
+   * The candidate values of `Params::targetClustersPerGroup`.
+   */
+  std::vector<size_t> targetClustersPerGroup = {4, 8};
+
+  /**
+   * The candidate values of `Params::clusterConeWeight`.
+   */
+  std::vector<float> clusterConeWeights = {0.0, 0.5};
+
+  /**
+   * The maximum number of triangles of the sample the candidates are built on.
+   * The sample consists of the triangles closest to the center of the input's bounding box.
+   * If this is 0, the whole input is used.
+   */
+  size_t maxSampleTriangles = 64 * 1024;
+
+  /**
+   * The reference errors at which the rendered triangles & clusters are counted, relative to the radius of the sample's bounding sphere.
+   */
+  std::vector<float> referenceErrors = {0.0, 0.001, 0.004, 0.016};
+
+  /**
+   * The cost of rendering a cluster relative to rendering a triangle, e.g., the overhead of a mesh shader workgroup.
+   */
+  float clusterCost = 16.0;
+
+  /**
+   * Scales the runtime cost of a candidate by `1 + fillRateWeight * (1 - meanFillRate)` to account for idle mesh shader threads in underfilled clusters.
+   */
+  float fillRateWeight = 1.0;
+
+  /**
+   * The weight of the build time relative to the runtime cost.
+   * Both are normalized by the lowest cost of all candidates before they are weighted.
+   */
+  float buildTimeWeight = 0.1;
+
+  /**
+   * The size of the thread pool each candidate is built with.
+   * Candidates are built one at a time, so that each candidate's build time is measured without other builds running concurrently.
+   * This is only used if trichi is built with TRICHI_PARALLEL enabled.
+   */
+  size_t threadPoolSize = 1;
+};
+
+/**
+ * The evaluation of a single candidate.
+ */
+struct AutotuneCandidate {
+  /**
+   * The parameters the candidate was built with.
+   */
+  Params params{};
+
+  /**
+   * The time it took to build the candidate's hierarchy.
+   */
+  double buildMilliseconds = 0.0;
+
+  /**
+   * The number of triangles rendered at each reference error.
+   */
+  std::vector<size_t> renderedTriangles{};
+
+  /**
+   * The number of clusters rendered at each reference error.
+   */
+  std::vector<size_t> renderedClusters{};
+
+  /**
+   * The mean fill rate of the candidate's clusters (see `HierarchyAnalysis::meanFillRate`).
+   */
+  float meanFillRate = 0.0;
+
+  /**
+   * The runtime cost of the candidate, i.e., the mean number of rendered triangles plus `clusterCost` times the mean number of rendered clusters, scaled by the fill rate penalty.
+   */
+  double runtimeCost = 0.0;
+
+  /**
+   * The combined, normalized cost of the candidate.
+   */
+  double cost = 0.0;
+};
+
+/**
+ * The result of autotuning `Params`.
+ */
+struct AutotuneResult {
+  /**
+   * The parameters of the candidate with the lowest cost.
+   */
+  Params params{};
+
+  /**
+   * All evaluated candidates in the order of their parameters.
+   */
+  std::vector<AutotuneCandidate> candidates{};
+};
+
+/**
+ * Chooses `Params::maxVerticesPerCluster`, `Params::maxTrianglesPerCluster`, `Params::targetClustersPerGroup` and `Params::clusterConeWeight` for an input mesh.
+ *
+ * @param indices the input mesh's indices
+ * @param vertices the input mesh's vertices
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params the parameters all other fields of the candidates' parameters are copied from, except for `Params::threadPoolSize`, which is replaced by `AutotuneParams::threadPoolSize`
+ * @param autotuneParams the autotuning parameters
+ * @return Returns the chosen parameters and the evaluation of all candidates.
+ * @throws std::runtime_error if there are no candidates.
+ */
+[[nodiscard]] AutotuneResult autotuneParams(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {}, const AutotuneParams& autotuneParams = {});
+
+/**
+ * Parameters for reordering a cluster hierarchy's vertices.
+ */
+struct VertexReorderParams {
+  /**
+   * If true, vertices used by clusters in different pages are duplicated, so that each page's vertices are stored contiguously and can be streamed independently.
+   */
+  bool duplicateVerticesPerPage = false;
+
+  /**
+   * The size of a page in bytes (see `StreamingParams::pageSizeBytes`).
+   * Vertices are ordered by their first use in page order, and pages are laid out like `simulateStreaming` lays them out for the same page size and a `StreamingParams::vertexSizeBytes` equal to the vertex stride.
+   */
+  size_t pageSizeBytes = 128 * 1024;
+
+  /**
+   * The number of threads used to reorder the vertices.
+   * This is only used if trichi is built with TRICHI_PARALLEL enabled.
+   */
+  size_t threadPoolSize = 1;
+};
+
+/**
+ * Reorders a cluster hierarchy's vertex buffer by first use in page & cluster order to improve vertex fetch locality, and remaps the hierarchy's vertex indices accordingly.
+ * Vertices that are not used by any cluster are removed.
+ *
+ * @param hierarchy the cluster hierarchy whose `ClusterHierarchy::vertices` are remapped
+ * @param vertices the vertex buffer the hierarchy was built from, which is replaced by the reordered vertex buffer
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params the reordering parameters
+ * @return Returns the original index of each vertex in the reordered vertex buffer, e.g., to reorder other vertex attribute streams the same way.
+ */
+[[nodiscard]] std::vector<uint32_t> reorderVertices(ClusterHierarchy& hierarchy, std::vector<float>& vertices, size_t vertexStride, const VertexReorderParams& params = {});
+
+/**
+ * Parameters for finding duplicate submeshes.
+ */
+struct DeduplicationParams {
+  /**
+   * The maximum distance between a submesh's vertices and the transformed vertices of the shape it is an instance of, relative to the submesh's bounding sphere radius.
+   */
+  float tolerance = 1e-4f;
+
+  /**
+   * The number of threads used to find duplicates.
+   * This is only used if trichi is built with TRICHI_PARALLEL enabled.
+   */
+  size_t threadPoolSize = 1;
+};
+
+/**
+ * A unique submesh, i.e., the geometry shared by all of its instances.
+ */
+struct Shape {
+  /**
+   * The shape's triangles, indexing into `vertices`.
+   */
+  std::vector<uint32_t> indices{};
+
+  /**
+   * The vertices of the first submesh with this shape, in order of first use, including all of their attributes.
+   */
+  std::vector<float> vertices{};
+
+  uint32_t materialId = 0;
+
+  /**
+   * The index of the first submesh with this shape.
+   */
+  size_t submeshIndex = 0;
+};
+
+/**
+ * A submesh as an instance of a shape.
+ */
+struct SubmeshInstance {
+  /**
+   * The index of the submesh's shape.
+   */
+  size_t shapeIndex = 0;
+
+  /**
+   * A row-major 3x4 rigid transform from the shape's positions to the submesh's positions.
+   * Other vertex attributes, e.g., normals, must be rotated by its upper 3x3 part.
+   */
+  std::array<float, 12> transform{1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+};
+
+/**
+ * The unique shapes of a mesh's submeshes.
+ */
+struct DeduplicatedSubmeshes {
+  std::vector<Shape> shapes{};
+
+  /**
+   * The instance of each submesh, in submesh order.
+   */
+  std::vector<SubmeshInstance> instances{};
+};
+
+/**
+ * Finds submeshes that are identical up to a rotation & translation, e.g., copies of the same geometry with baked transforms.
+ *
+ * Two submeshes are identical if they have the same material and the same triangles when their vertices are numbered in order of first use, and if one's positions are within `DeduplicationParams::tolerance` of a rigid transform of the other's.
+ * Candidates are found by hashing the submeshes' triangles in parallel and narrowed down by their bounding sphere radii, which don't change under rigid transforms, before they are verified by aligning their centered positions.
+ *
+ * @param indices the input meshes vertex indices
+ * @param submeshes ranges of `indices` and their materials
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params the deduplication parameters
+ * @return Returns the unique shapes, ordered by their first submesh, and an instance for each submesh.
+ */
+[[nodiscard]] DeduplicatedSubmeshes deduplicateSubmeshes(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, size_t vertexStride, const DeduplicationParams& params = {});
+
+/**
+ * Cluster hierarchies for the unique shapes of a mesh's submeshes.
+ */
+struct InstancedClusterHierarchies {
+  /**
+   * A cluster hierarchy for each shape in `DeduplicatedSubmeshes::shapes`, indexing into the shape's vertices.
+   */
+  std::vector<ClusterHierarchy> hierarchies{};
+
+  DeduplicatedSubmeshes submeshes{};
+};
+
+/**
+ * Builds a cluster hierarchy for each unique shape of a mesh's submeshes (see `deduplicateSubmeshes`) instead of one for the whole mesh.
+ * Each submesh is then rendered as an instance of its shape's hierarchy.
+ *
+ * @param indices the input meshes vertex indices
+ * @param submeshes ranges of `indices` and their materials
+ * @param vertices the input meshes vertices - the first 3 floats of a vertex are expected to store the position.
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params tuning parameters for building the cluster hierarchies
+ * @param deduplicationParams the deduplication parameters
+ * @return Returns the shapes' cluster hierarchies and the submeshes' instances.
+ * @throws BuildAbortedError if a build was cancelled or exceeded its time limit or memory budget.
+ */
+[[nodiscard]] InstancedClusterHierarchies buildInstancedClusterHierarchies(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, size_t vertexStride, const Params& params = {}, const DeduplicationParams& deduplicationParams = {});
 }
 
 #endif  //TRICHI_HPP
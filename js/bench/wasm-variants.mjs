@@ -0,0 +1,174 @@
+/**
+ * Compares the build times of the trichi-wasm variants on procedural meshes.
+ *
+ * Usage: node bench/wasm-variants.mjs [--runs 5] [--threads 4] [--size 256]
+ *
+ * Variants are loaded from src/wasm (see wasm/README.md for building them), variants that have not been built are skipped.
+ * Each variant's hierarchies are compared to the ones built by the first variant, so that optimizations that change the output are noticed.
+ */
+import {existsSync} from 'node:fs';
+import {createRequire} from 'node:module';
+import {availableParallelism} from 'node:os';
+import {fileURLToPath} from 'node:url';
+import {parseArgs} from 'node:util';
+
+// ES6 modules built by older versions of emscripten still use CommonJS globals when running in node
+globalThis.require ??= createRequire(import.meta.url);
+globalThis.__dirname ??= fileURLToPath(new URL('../src/wasm/', import.meta.url));
+
+const {values: args} = parseArgs({
+    options: {
+        runs: {type: 'string', default: '5'},
+        threads: {type: 'string', default: `${availableParallelism()}`},
+        size: {type: 'string', default: '256'},
+    },
+});
+const runs = Math.max(Number(args.runs), 1);
+const maxThreads = Math.max(Number(args.threads), 1);
+const size = Math.max(Number(args.size), 2);
+
+const variants = [
+    'trichi-wasm',
+    'trichi-wasm-simd',
+    'trichi-wasm-threads',
+    'trichi-wasm-threads-simd',
+];
+
+/**
+ * A height field with size x size quads.
+ */
+function makeTerrain(size) {
+    const vertices = new Float32Array((size + 1) * (size + 1) * 3);
+    for (let y = 0; y <= size; ++y) {
+        for (let x = 0; x <= size; ++x) {
+            const i = (y * (size + 1) + x) * 3;
+            vertices[i] = x;
+            vertices[i + 1] = Math.sin(x * 0.1) * Math.cos(y * 0.07) * 4.0;
+            vertices[i + 2] = y;
+        }
+    }
+    const indices = new Uint32Array(size * size * 6);
+    for (let y = 0, i = 0; y < size; ++y) {
+        for (let x = 0; x < size; ++x, i += 6) {
+            const a = y * (size + 1) + x;
+            const c = a + size + 1;
+            indices.set([a, c, a + 1, a + 1, c, c + 1], i);
+        }
+    }
+    return {name: `terrain ${size}x${size}`, indices, vertices};
+}
+
+/**
+ * A closed torus with size x size / 2 quads.
+ */
+function makeTorus(size) {
+    const rings = size;
+    const segments = Math.max(Math.floor(size / 2), 3);
+    const vertices = new Float32Array(rings * segments * 3);
+    for (let r = 0; r < rings; ++r) {
+        const u = r / rings * 2.0 * Math.PI;
+        for (let s = 0; s < segments; ++s) {
+            const v = s / segments * 2.0 * Math.PI;
+            const i = (r * segments + s) * 3;
+            vertices[i] = (4.0 + Math.cos(v)) * Math.cos(u);
+            vertices[i + 1] = Math.sin(v);
+            vertices[i + 2] = (4.0 + Math.cos(v)) * Math.sin(u);
+        }
+    }
+    const indices = new Uint32Array(rings * segments * 6);
+    for (let r = 0, i = 0; r < rings; ++r) {
+        for (let s = 0; s < segments; ++s, i += 6) {
+            const a = r * segments + s;
+            const b = r * segments + (s + 1) % segments;
+            const c = ((r + 1) % rings) * segments + s;
+            const d = ((r + 1) % rings) * segments + (s + 1) % segments;
+            indices.set([a, b, c, b, d, c], i);
+        }
+    }
+    return {name: `torus ${rings}x${segments}`, indices, vertices};
+}
+
+function makeParams(threadPoolSize) {
+    return {
+        maxVerticesPerCluster: 64,
+        maxTrianglesPerCluster: 128,
+        clusterConeWeight: 0.0,
+        targetClustersPerGroup: 4,
+        maxHierarchyDepth: 25,
+        threadPoolSize,
+        seed: 0,
+        deferClusterOptimization: false,
+        partitionRegions: 0,
+        sortClustersSpatially: false,
+        timeLimitMilliseconds: 0,
+        memoryBudgetBytes: 0,
+    };
+}
+
+/**
+ * Hashes a hierarchy's clusters & errors with FNV-1a.
+ */
+function hashHierarchy(hierarchy) {
+    let hash = 0x811c9dc5;
+    for (const array of [hierarchy.clusters, hierarchy.clusterVertices, hierarchy.clusterTriangles, hierarchy.errors]) {
+        const words = new Uint32Array(array.buffer, array.byteOffset, array.byteLength / 4);
+        for (let i = 0; i < words.length; ++i) {
+            hash = Math.imul(hash ^ words[i], 0x01000193) >>> 0;
+        }
+    }
+    return hash;
+}
+
+function median(values) {
+    const sorted = [...values].sort((a, b) => a - b);
+    return sorted[Math.floor(sorted.length / 2)];
+}
+
+const meshes = [makeTerrain(size), makeTorus(size)];
+const results = [];
+const referenceHashes = new Map();
+for (const variant of variants) {
+    const modulePath = new URL(`../src/wasm/${variant}.js`, import.meta.url);
+    if (!existsSync(modulePath) || !existsSync(new URL(`../src/wasm/${variant}.wasm`, import.meta.url))) {
+        console.log(`${variant}: not built, skipped`);
+        continue;
+    }
+    const module = await import(modulePath.href);
+    const trichi = await new module.default({maxThreads});
+    const params = makeParams(variant.includes('threads') ? maxThreads : 1);
+
+    for (const mesh of meshes) {
+        // the first build warms up the module, e.g., its thread pool
+        trichi.buildTriangleClusterHierarchy(mesh.indices, mesh.vertices, 12, params);
+        const times = [];
+        let hash = 0;
+        for (let run = 0; run < runs; ++run) {
+            const start = performance.now();
+            const hierarchy = trichi.buildTriangleClusterHierarchy(mesh.indices, mesh.vertices, 12, params);
+            times.push(performance.now() - start);
+            hash = hashHierarchy(hierarchy);
+        }
+        if (!referenceHashes.has(mesh.name)) {
+            referenceHashes.set(mesh.name, hash);
+        }
+        results.push({
+            variant,
+            mesh: mesh.name,
+            triangles: mesh.indices.length / 3,
+            medianMs: median(times),
+            sameOutput: referenceHashes.get(mesh.name) === hash,
+        });
+    }
+}
+
+for (const mesh of meshes) {
+    const baseline = results.find(result => result.mesh === mesh.name);
+    for (const result of results.filter(result => result.mesh === mesh.name)) {
+        const speedup = baseline.medianMs / result.medianMs;
+        const throughput = result.triangles / result.medianMs * 1000.0;
+        console.log(`${result.mesh.padEnd(20)} ${result.variant.padEnd(26)} ${result.medianMs.toFixed(1).padStart(9)} ms ` +
+            `${speedup.toFixed(2).padStart(6)}x ${Math.round(throughput).toString().padStart(10)} triangles/s` +
+            `${result.sameOutput ? '' : '  (output differs from ' + baseline.variant + ')'}`);
+    }
+}
+process.exit(0);
@@ -1,2 +1,3 @@
-async function a(a=navigator.hardwareConcurrency){const e=await(async a=>{try{return"undefined"!=typeof MessageChannel&&(new MessageChannel).port1.postMessage(new SharedArrayBuffer(1)),WebAssembly.validate(a)}catch(a){return!1}})(new Uint8Array([0,97,115,109,1,0,0,0,1,4,1,96,0,0,3,2,1,0,5,4,1,3,1,1,10,11,1,9,0,65,0,254,16,2,0,26,11]))?"./wasm/trichi-wasm-threads.js":"./wasm/trichi-wasm.js";return new((await import(e)).default)({maxThreads:Math.min(a,navigator.hardwareConcurrency)})}export{a as default};
+/* trichi@0.1.0, license MIT */
+function e(e){Atomics.store(new Uint8Array(e.buffer),e.byteOffset,1)}function a(e){Atomics.store(new Uint8Array(e.buffer),e.byteOffset,0)}function t(e){return{...e,seed:e.seed??0,deferClusterOptimization:e.deferClusterOptimization??!1,partitionRegions:e.partitionRegions??0,sortClustersSpatially:e.sortClustersSpatially??!1,timeLimitMilliseconds:e.timeLimitMilliseconds??0,memoryBudgetBytes:e.memoryBudgetBytes??0}}async function r(e=navigator.hardwareConcurrency,a={}){const r=a.threads??await(async e=>{try{return"undefined"!=typeof MessageChannel&&(new MessageChannel).port1.postMessage(new SharedArrayBuffer(1)),WebAssembly.validate(e)}catch(e){return!1}})(new Uint8Array([0,97,115,109,1,0,0,0,1,4,1,96,0,0,3,2,1,0,5,4,1,3,1,1,10,11,1,9,0,65,0,254,16,2,0,26,11])),i=(a.simd??!1)&&await(async()=>WebAssembly.validate(new Uint8Array([0,97,115,109,1,0,0,0,1,5,1,96,0,1,123,3,2,1,0,10,10,1,8,0,65,0,253,15,253,98,11])))(),n=`./wasm/trichi-wasm${r?"-threads":""}`;let s;try{s=await import(`${n}${i?"-simd":""}.js`)}catch(e){if(!i)throw e;s=await import(`${n}.js`)}const u=await new s.default({maxThreads:Math.min(e,navigator.hardwareConcurrency)});return{buildTriangleClusterHierarchy:(e,a,r,i)=>u.buildTriangleClusterHierarchy(e,a,r,t(i)),buildMultiMaterialTriangleClusterHierarchy:(e,a,r,i,n)=>u.buildMultiMaterialTriangleClusterHierarchy(e,a,r,i,t(n)),buildTriangleClusterHierarchyFromFileBlob:(e,a,r)=>u.buildTriangleClusterHierarchyFromFileBlob(e,a,t(r)),getCancellationHandle(){const e=u.getCancellationToken();if("undefined"!=typeof SharedArrayBuffer&&e.buffer instanceof SharedArrayBuffer)return{buffer:e.buffer,byteOffset:e.byteOffset}}}}export{e as cancelBuild,r as default,a as resetCancellation};
 //# sourceMappingURL=trichi.module.min.js.map
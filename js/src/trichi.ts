@@ -1,4 +1,4 @@
-import {threads} from 'wasm-feature-detect';
+import {simd, threads} from 'wasm-feature-detect';
 
 /**
  * Tuning parameters for generating triangle cluster hierarchies
@@ -37,6 +37,48 @@ export interface Params {
      * If this is 0, defaults to 1.
      */
     threadPoolSize: number,
+
+    /**
+     * The seed for METIS' random number generator used when grouping clusters.
+     * For a given input and set of parameters, the resulting hierarchy is the same, independent of `threadPoolSize`.
+     * Defaults to 0.
+     */
+    seed?: number,
+
+    /**
+     * If true, clusters are optimized for locality in a single parallel pass at the end of the build instead of per level.
+     * The resulting hierarchy differs slightly from the one built with this set to false.
+     * Defaults to false.
+     */
+    deferClusterOptimization?: boolean,
+
+    /**
+     * The number of spatial regions each level's clusters are split into before they are grouped in parallel.
+     * Small groups at region borders are merged with their neighbors afterward.
+     * If this is 0 or 1, each level is grouped as a whole.
+     * Defaults to 0.
+     */
+    partitionRegions?: number,
+
+    /**
+     * If true, the clusters of each level are sorted by the Morton code of their bounds' centers, so that spatially close clusters are also close in memory.
+     * Defaults to false.
+     */
+    sortClustersSpatially?: boolean,
+
+    /**
+     * The maximum time in milliseconds building the hierarchy may take before it is aborted.
+     * If this is 0, there is no time limit.
+     * Defaults to 0.
+     */
+    timeLimitMilliseconds?: number,
+
+    /**
+     * The maximum (estimated) number of bytes the hierarchy may occupy before the build is aborted.
+     * If this is 0, there is no memory budget.
+     * Defaults to 0.
+     */
+    memoryBudgetBytes?: number,
 }
 
 /**
@@ -101,6 +143,18 @@ export interface TriangleClusterHierarchy {
      *    clusterTriangles[clusters[c + 1], clusterTriangles[clusters[c + 1] + clusters[c + 3] * 3]
      */
     clusterTriangles: Uint32Array,
+
+    /**
+     * The material id of each cluster in the hierarchy.
+     * For hierarchies built from a single mesh, all clusters have the material id 0.
+     */
+    clusterMaterials: Uint32Array,
+
+    /**
+     * True if the build was cancelled (see {@link cancelBuild}) or aborted because it exceeded its time limit or memory budget.
+     * In this case, the hierarchy only contains the levels that were completed before the build was aborted.
+     */
+    aborted: boolean,
 }
 
 export interface Trichi {
@@ -117,29 +171,158 @@ export interface Trichi {
      */
     buildTriangleClusterHierarchy(indices: Uint32Array, vertices: Float32Array, vertexStrideBytes: number, params: Params): TriangleClusterHierarchy,
 
+    /**
+     * Builds a single cluster hierarchy for a triangle mesh consisting of multiple submeshes with different materials.
+     *
+     * Clusters never mix materials, but clusters of different submeshes may be grouped and simplified together.
+     * Each cluster's material is stored in {@link TriangleClusterHierarchy#clusterMaterials}.
+     *
+     * @param indices vertex indices of the input mesh
+     * @param submeshes for each submesh, 3 unsigned integers: its first index in `indices`, its number of indices, and its material id
+     * @param vertices vertices of the input mesh - the first 3 floats of a vertex are expected to store the position
+     * @param vertexStrideBytes the size of each vertex in the vertices array in bytes
+     * @param params tuning parameters for building the cluster hierarchy
+     */
+    buildMultiMaterialTriangleClusterHierarchy(indices: Uint32Array, submeshes: Uint32Array, vertices: Float32Array, vertexStrideBytes: number, params: Params): TriangleClusterHierarchy,
+
     /**
      * Builds a cluster hierarchy for a 3d model given as a file blob.
      *
      * This function is currently more for demonstration purposes, as it...
      *  - ignores vertex attributes: The returned vertices will only contain position data.
-     *  - creates the hierarchy only for the first mesh that is found in the file blob
+     *  - merges all meshes found in the file blob into one hierarchy, using each mesh's material index as its material id
      *
      * @param fileName the name of the file blob, used as a file type hint when loading model data
      * @param bytes the raw bytes containing the model data
      * @param params tuning parameters for building the cluster hierarchy
      */
     buildTriangleClusterHierarchyFromFileBlob(fileName: string, bytes: Uint8Array, params: Params): TriangleClusterHierarchy,
+
+    /**
+     * Returns a handle for cancelling this module's builds from another thread (see {@link cancelBuild}).
+     *
+     * Builds run synchronously, so they can't be cancelled from the thread that started them.
+     * The handle refers to the module's shared memory and can be sent to other threads, e.g., via `postMessage`.
+     * Only modules built with multithreading have shared memory, so for other modules this returns undefined.
+     */
+    getCancellationHandle(): CancellationHandle | undefined,
+}
+
+/**
+ * A handle for cancelling the builds of a {@link Trichi} module from another thread.
+ */
+export interface CancellationHandle {
+    /**
+     * The module's memory.
+     */
+    buffer: SharedArrayBuffer,
+
+    /**
+     * The offset of the module's cancellation token in `buffer`.
+     */
+    byteOffset: number,
+}
+
+/**
+ * Cancels the build currently running in the {@link Trichi} module the given handle belongs to.
+ * The cancelled build returns the levels completed so far and sets {@link TriangleClusterHierarchy#aborted}.
+ *
+ * The cancellation is reset when the cancelled build returns.
+ * If no build is running, the module's next build is cancelled instead, unless the cancellation is reset using {@link resetCancellation} first.
+ *
+ * @param handle the module's cancellation handle
+ */
+export function cancelBuild(handle: CancellationHandle) {
+    Atomics.store(new Uint8Array(handle.buffer), handle.byteOffset, 1);
+}
+
+/**
+ * Resets a cancellation that did not reach a build, e.g., because the build returned before {@link cancelBuild} was called.
+ * This must only be called while the module is not building a hierarchy.
+ *
+ * @param handle the module's cancellation handle
+ */
+export function resetCancellation(handle: CancellationHandle) {
+    Atomics.store(new Uint8Array(handle.buffer), handle.byteOffset, 0);
+}
+
+/**
+ * The functions exported by the WebAssembly module.
+ */
+interface TrichiModule extends Omit<Trichi, 'getCancellationHandle'> {
+    getCancellationToken(): Uint8Array,
+}
+
+/**
+ * The WebAssembly features a {@link Trichi} module variant is built with.
+ */
+export interface WasmFeatures {
+    /**
+     * Use the multithreaded variant.
+     */
+    threads: boolean,
+
+    /**
+     * Use the variant built with WebAssembly SIMD.
+     * SIMD variants are not part of the published package yet, so this is only used if requested explicitly and supported by the environment.
+     */
+    simd: boolean,
+}
+
+/**
+ * Fills in the defaults of optional {@link Params}, since the WebAssembly module requires all of them to be set.
+ */
+function withDefaultParams(params: Params): Required<Params> {
+    return {
+        ...params,
+        seed: params.seed ?? 0,
+        deferClusterOptimization: params.deferClusterOptimization ?? false,
+        partitionRegions: params.partitionRegions ?? 0,
+        sortClustersSpatially: params.sortClustersSpatially ?? false,
+        timeLimitMilliseconds: params.timeLimitMilliseconds ?? 0,
+        memoryBudgetBytes: params.memoryBudgetBytes ?? 0,
+    };
 }
 
 /**
  * Initializes a {@link Trichi} module.
  *
  * @param maxThreadPoolSize sets the maximum number of threads in the module's thread pool. In environments that do not support multithreading, this is ignored.
+ * @param features overrides the detected WebAssembly features to pick a specific module variant, e.g., for benchmarking. If `threads` is not set, it is detected. If `simd` is not set, it defaults to false.
  */
-export default async function initTrichiJs(maxThreadPoolSize: number = navigator.hardwareConcurrency): Promise<Trichi> {
-    const moduleName = (await threads()) ? './wasm/trichi-wasm-threads.js' : './wasm/trichi-wasm.js';
+export default async function initTrichiJs(maxThreadPoolSize: number = navigator.hardwareConcurrency, features: Partial<WasmFeatures> = {}): Promise<Trichi> {
+    const useThreads = features.threads ?? await threads();
+    const useSimd = (features.simd ?? false) && await simd();
+    const moduleName = `./wasm/trichi-wasm${useThreads ? '-threads' : ''}`;
 
-    const module = await import(moduleName) as unknown;
+    let module: unknown;
+    try {
+        module = await import(`${moduleName}${useSimd ? '-simd' : ''}.js`);
+    } catch (e) {
+        if (!useSimd) {
+            throw e;
+        }
+        // the SIMD variant may not have been built, so the variant without SIMD is used instead
+        module = await import(`${moduleName}.js`);
+    }
     // @ts-expect-error we don't care if the module's type is unknown here
-    return new module.default({maxThreads: Math.min(maxThreadPoolSize, navigator.hardwareConcurrency)}) as Promise<Trichi>;
+    const trichi = await (new module.default({maxThreads: Math.min(maxThreadPoolSize, navigator.hardwareConcurrency)}) as Promise<TrichiModule>);
+    return {
+        buildTriangleClusterHierarchy(indices: Uint32Array, vertices: Float32Array, vertexStrideBytes: number, params: Params): TriangleClusterHierarchy {
+            return trichi.buildTriangleClusterHierarchy(indices, vertices, vertexStrideBytes, withDefaultParams(params));
+        },
+        buildMultiMaterialTriangleClusterHierarchy(indices: Uint32Array, submeshes: Uint32Array, vertices: Float32Array, vertexStrideBytes: number, params: Params): TriangleClusterHierarchy {
+            return trichi.buildMultiMaterialTriangleClusterHierarchy(indices, submeshes, vertices, vertexStrideBytes, withDefaultParams(params));
+        },
+        buildTriangleClusterHierarchyFromFileBlob(fileName: string, bytes: Uint8Array, params: Params): TriangleClusterHierarchy {
+            return trichi.buildTriangleClusterHierarchyFromFileBlob(fileName, bytes, withDefaultParams(params));
+        },
+        getCancellationHandle(): CancellationHandle | undefined {
+            const token = trichi.getCancellationToken();
+            if (typeof SharedArrayBuffer === 'undefined' || !(token.buffer instanceof SharedArrayBuffer)) {
+                return undefined;
+            }
+            return {buffer: token.buffer, byteOffset: token.byteOffset};
+        },
+    };
 }
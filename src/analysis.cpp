@@ -0,0 +1,160 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <sstream>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Per-cluster measurements that are aggregated per level.
+ */
+struct ClusterAnalysis {
+  float fillRate = 0.0;
+  float boundaryEdgeRatio = 0.0;
+  bool violatesErrorMonotonicity = false;
+  size_t memoryBytes = 0;
+};
+
+[[nodiscard]] ClusterAnalysis analyzeCluster(const ClusterHierarchy& hierarchy, const size_t clusterIndex, const AnalysisParams& params) {
+  const auto& cluster = hierarchy.clusters[clusterIndex];
+  const auto& errors = hierarchy.errors[clusterIndex];
+
+  ClusterAnalysis analysis{};
+  analysis.fillRate = static_cast<float>(cluster.triangleCount) / static_cast<float>(std::max(params.maxTrianglesPerCluster, static_cast<size_t>(1)));
+
+  // each interior edge is shared by two triangles, each boundary edge belongs to only one
+  std::array<uint64_t, kMaxTrianglesPerCluster * 3> boundary;
+  const size_t numBoundaryEdges = extractBoundary(cluster, &hierarchy.vertices[cluster.vertexOffset], &hierarchy.triangles[cluster.triangleOffset], boundary.data());
+  const size_t numEdges = (cluster.triangleCount * 3 + numBoundaryEdges) / 2;
+  analysis.boundaryEdgeRatio = numEdges == 0 ? 0.0f : static_cast<float>(numBoundaryEdges) / static_cast<float>(numEdges);
+
+  analysis.violatesErrorMonotonicity = errors.clusterError.error > errors.parentError.error ||
+      std::any_of(hierarchy.nodes[clusterIndex].childNodeIndices.cbegin(), hierarchy.nodes[clusterIndex].childNodeIndices.cend(), [&](const size_t child) {
+        return hierarchy.errors[child].clusterError.error > errors.clusterError.error;
+      });
+
+  analysis.memoryBytes = sizeof(Cluster) + sizeof(NodeErrorBounds) + sizeof(ClusterBounds) +
+      cluster.vertexCount * sizeof(uint32_t) + cluster.triangleCount * 3 * sizeof(uint8_t);
+  return analysis;
+}
+
+HierarchyAnalysis analyzeClusterHierarchy(const ClusterHierarchy& hierarchy, const AnalysisParams& params) {
+  const size_t numClusters = hierarchy.clusters.size();
+  if (hierarchy.nodes.size() != numClusters || hierarchy.errors.size() != numClusters) {
+    throw std::runtime_error("could not analyze hierarchy: number of nodes, clusters and errors differ");
+  }
+
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  std::vector<ClusterAnalysis> clusterAnalyses(numClusters);
+  loopRunner.loop(0, numClusters, [&](const size_t clusterIndex) {
+    clusterAnalyses[clusterIndex] = analyzeCluster(hierarchy, clusterIndex, params);
+  });
+
+  HierarchyAnalysis analysis{};
+  analysis.numClusters = numClusters;
+  analysis.numRoots = hierarchy.rootNodes.size();
+
+  const auto levels = computeNodeLevels(hierarchy);
+  std::vector<double> fillRateSums{};
+  std::vector<double> boundaryEdgeRatioSums{};
+  for (size_t clusterIndex = 0; clusterIndex < numClusters; ++clusterIndex) {
+    const size_t level = levels[clusterIndex];
+    if (level >= analysis.levels.size()) {
+      analysis.levels.resize(level + 1, LevelAnalysis{
+          .minFillRate = std::numeric_limits<float>::max(),
+          .minError = std::numeric_limits<float>::max(),
+          .maxError = std::numeric_limits<float>::lowest(),
+      });
+      fillRateSums.resize(level + 1, 0.0);
+      boundaryEdgeRatioSums.resize(level + 1, 0.0);
+    }
+    const auto& cluster = hierarchy.clusters[clusterIndex];
+    const auto& clusterAnalysis = clusterAnalyses[clusterIndex];
+    const float error = hierarchy.errors[clusterIndex].clusterError.error;
+    auto& levelAnalysis = analysis.levels[level];
+    ++levelAnalysis.numClusters;
+    levelAnalysis.numTriangles += cluster.triangleCount;
+    levelAnalysis.numVertices += cluster.vertexCount;
+    levelAnalysis.minFillRate = std::min(levelAnalysis.minFillRate, clusterAnalysis.fillRate);
+    levelAnalysis.minError = std::min(levelAnalysis.minError, error);
+    levelAnalysis.maxError = std::max(levelAnalysis.maxError, error);
+    if (clusterAnalysis.fillRate < params.underfilledThreshold) {
+      ++levelAnalysis.numUnderfilledClusters;
+    }
+    if (clusterAnalysis.violatesErrorMonotonicity) {
+      ++levelAnalysis.errorMonotonicityViolations;
+    }
+    levelAnalysis.memoryBytes += clusterAnalysis.memoryBytes;
+    fillRateSums[level] += clusterAnalysis.fillRate;
+    boundaryEdgeRatioSums[level] += clusterAnalysis.boundaryEdgeRatio;
+  }
+
+  double fillRateSum = 0.0;
+  for (size_t level = 0; level < analysis.levels.size(); ++level) {
+    auto& levelAnalysis = analysis.levels[level];
+    if (levelAnalysis.numClusters == 0) {
+      levelAnalysis.minFillRate = 0.0;
+      levelAnalysis.minError = 0.0;
+      levelAnalysis.maxError = 0.0;
+    } else {
+      levelAnalysis.meanFillRate = static_cast<float>(fillRateSums[level] / static_cast<double>(levelAnalysis.numClusters));
+      levelAnalysis.meanBoundaryEdgeRatio = static_cast<float>(boundaryEdgeRatioSums[level] / static_cast<double>(levelAnalysis.numClusters));
+    }
+    if (level > 0 && analysis.levels[level - 1].numTriangles > 0) {
+      levelAnalysis.triangleReduction = static_cast<float>(levelAnalysis.numTriangles) / static_cast<float>(analysis.levels[level - 1].numTriangles);
+    }
+    analysis.numTriangles += levelAnalysis.numTriangles;
+    analysis.numUnderfilledClusters += levelAnalysis.numUnderfilledClusters;
+    analysis.errorMonotonicityViolations += levelAnalysis.errorMonotonicityViolations;
+    analysis.memoryBytes += levelAnalysis.memoryBytes;
+    fillRateSum += fillRateSums[level];
+  }
+  analysis.depth = analysis.levels.size();
+  if (numClusters > 0) {
+    analysis.meanFillRate = static_cast<float>(fillRateSum / static_cast<double>(numClusters));
+  }
+
+  return std::move(analysis);
+}
+
+std::string toJson(const HierarchyAnalysis& analysis) {
+  std::ostringstream json{};
+  json << "{\n";
+  json << "  \"numClusters\": " << analysis.numClusters << ",\n";
+  json << "  \"numTriangles\": " << analysis.numTriangles << ",\n";
+  json << "  \"numRoots\": " << analysis.numRoots << ",\n";
+  json << "  \"depth\": " << analysis.depth << ",\n";
+  json << "  \"meanFillRate\": " << analysis.meanFillRate << ",\n";
+  json << "  \"numUnderfilledClusters\": " << analysis.numUnderfilledClusters << ",\n";
+  json << "  \"errorMonotonicityViolations\": " << analysis.errorMonotonicityViolations << ",\n";
+  json << "  \"memoryBytes\": " << analysis.memoryBytes << ",\n";
+  json << "  \"levels\": [";
+  for (size_t i = 0; i < analysis.levels.size(); ++i) {
+    const auto& level = analysis.levels[i];
+    json << (i == 0 ? "\n" : ",\n");
+    json << "    {\n";
+    json << "      \"numClusters\": " << level.numClusters << ",\n";
+    json << "      \"numTriangles\": " << level.numTriangles << ",\n";
+    json << "      \"numVertices\": " << level.numVertices << ",\n";
+    json << "      \"triangleReduction\": " << level.triangleReduction << ",\n";
+    json << "      \"meanFillRate\": " << level.meanFillRate << ",\n";
+    json << "      \"minFillRate\": " << level.minFillRate << ",\n";
+    json << "      \"numUnderfilledClusters\": " << level.numUnderfilledClusters << ",\n";
+    json << "      \"meanBoundaryEdgeRatio\": " << level.meanBoundaryEdgeRatio << ",\n";
+    json << "      \"minError\": " << level.minError << ",\n";
+    json << "      \"maxError\": " << level.maxError << ",\n";
+    json << "      \"errorMonotonicityViolations\": " << level.errorMonotonicityViolations << ",\n";
+    json << "      \"memoryBytes\": " << level.memoryBytes << "\n";
+    json << "    }";
+  }
+  json << (analysis.levels.empty() ? "]\n" : "\n  ]\n");
+  json << "}\n";
+  return json.str();
+}
+}  // namespace trichi
@@ -0,0 +1,189 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * A compact copy of a representative part of an input mesh.
+ */
+struct MeshSample {
+  std::vector<uint32_t> indices{};
+  std::vector<float> vertices{};
+  float radius = 0.0;
+};
+
+/**
+ * Samples the triangles closest to the center of a mesh's bounding box.
+ * Sampled triangles keep their input order and only the vertices they use are copied.
+ */
+[[nodiscard]] MeshSample sampleMesh(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const size_t maxTriangles) {
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  const size_t numVertices = vertices.size() / floatsPerVertex;
+  const size_t numTriangles = indices.size() / 3;
+  for (const uint32_t index : indices) {
+    if (index >= numVertices) {
+      throw std::runtime_error("could not autotune params: index out of range");
+    }
+  }
+  const auto position = [&](const uint32_t vertexIndex) {
+    return &vertices[vertexIndex * floatsPerVertex];
+  };
+
+  float aabbMin[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+  float aabbMax[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+  for (const uint32_t index : indices) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      aabbMin[axis] = std::min(aabbMin[axis], position(index)[axis]);
+      aabbMax[axis] = std::max(aabbMax[axis], position(index)[axis]);
+    }
+  }
+  const float center[3] = {(aabbMin[0] + aabbMax[0]) * 0.5f, (aabbMin[1] + aabbMax[1]) * 0.5f, (aabbMin[2] + aabbMax[2]) * 0.5f};
+
+  std::vector<size_t> triangles(numTriangles);
+  std::iota(triangles.begin(), triangles.end(), 0);
+  if (maxTriangles != 0 && maxTriangles < numTriangles) {
+    std::vector<float> distances(numTriangles);
+    for (size_t i = 0; i < numTriangles; ++i) {
+      float d = 0.0f;
+      for (size_t axis = 0; axis < 3; ++axis) {
+        const float centroid = (position(indices[i * 3])[axis] + position(indices[i * 3 + 1])[axis] + position(indices[i * 3 + 2])[axis]) / 3.0f;
+        d += (centroid - center[axis]) * (centroid - center[axis]);
+      }
+      distances[i] = d;
+    }
+    std::nth_element(triangles.begin(), triangles.begin() + static_cast<ptrdiff_t>(maxTriangles), triangles.end(), [&](const size_t a, const size_t b) {
+      return distances[a] != distances[b] ? distances[a] < distances[b] : a < b;
+    });
+    triangles.resize(maxTriangles);
+    std::sort(triangles.begin(), triangles.end());
+  }
+
+  MeshSample sample{};
+  std::vector<uint32_t> remap(numVertices, std::numeric_limits<uint32_t>::max());
+  sample.indices.reserve(triangles.size() * 3);
+  for (const size_t triangle : triangles) {
+    for (size_t i = 0; i < 3; ++i) {
+      const uint32_t index = indices[triangle * 3 + i];
+      if (remap[index] == std::numeric_limits<uint32_t>::max()) {
+        remap[index] = static_cast<uint32_t>(sample.vertices.size() / floatsPerVertex);
+        sample.vertices.insert(sample.vertices.end(), position(index), position(index) + floatsPerVertex);
+      }
+      sample.indices.emplace_back(remap[index]);
+    }
+  }
+
+  float sampleMin[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+  float sampleMax[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+  for (size_t i = 0; i < sample.vertices.size(); i += floatsPerVertex) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      sampleMin[axis] = std::min(sampleMin[axis], sample.vertices[i + axis]);
+      sampleMax[axis] = std::max(sampleMax[axis], sample.vertices[i + axis]);
+    }
+  }
+  if (!sample.vertices.empty()) {
+    sample.radius = 0.5f * std::sqrt(
+        (sampleMax[0] - sampleMin[0]) * (sampleMax[0] - sampleMin[0]) +
+        (sampleMax[1] - sampleMin[1]) * (sampleMax[1] - sampleMin[1]) +
+        (sampleMax[2] - sampleMin[2]) * (sampleMax[2] - sampleMin[2]));
+  }
+  return std::move(sample);
+}
+
+[[nodiscard]] AutotuneCandidate evaluateCandidate(const MeshSample& sample, const size_t vertexStride, const Params& params, const AutotuneParams& autotuneParams) {
+  AutotuneCandidate candidate{.params = params};
+
+  const auto startTime = std::chrono::steady_clock::now();
+  const auto hierarchy = buildClusterHierarchy(sample.indices, sample.vertices, vertexStride, params);
+  candidate.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+  candidate.meanFillRate = analyzeClusterHierarchy(hierarchy, AnalysisParams{.maxTrianglesPerCluster = params.maxTrianglesPerCluster}).meanFillRate;
+
+  // clusters are rendered at a reference error like `extractMesh` selects them
+  double meanTriangles = 0.0;
+  double meanClusters = 0.0;
+  for (const float relativeError : autotuneParams.referenceErrors) {
+    const float maxError = relativeError * sample.radius;
+    size_t triangles = 0;
+    size_t clusters = 0;
+    for (size_t clusterIndex = 0; clusterIndex < hierarchy.clusters.size(); ++clusterIndex) {
+      const auto& errors = hierarchy.errors[clusterIndex];
+      if (errors.clusterError.error <= maxError && errors.parentError.error > maxError) {
+        triangles += hierarchy.clusters[clusterIndex].triangleCount;
+        ++clusters;
+      }
+    }
+    candidate.renderedTriangles.emplace_back(triangles);
+    candidate.renderedClusters.emplace_back(clusters);
+    meanTriangles += static_cast<double>(triangles);
+    meanClusters += static_cast<double>(clusters);
+  }
+  if (!autotuneParams.referenceErrors.empty()) {
+    meanTriangles /= static_cast<double>(autotuneParams.referenceErrors.size());
+    meanClusters /= static_cast<double>(autotuneParams.referenceErrors.size());
+  }
+  candidate.runtimeCost = (meanTriangles + autotuneParams.clusterCost * meanClusters) *
+      (1.0 + autotuneParams.fillRateWeight * (1.0 - candidate.meanFillRate));
+  return candidate;
+}
+
+AutotuneResult autotuneParams(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const Params& params, const AutotuneParams& autotuneParams) {
+  std::vector<Params> candidateParams{};
+  for (const auto& clusterSize : autotuneParams.clusterSizes) {
+    for (const size_t targetClustersPerGroup : autotuneParams.targetClustersPerGroup) {
+      for (const float clusterConeWeight : autotuneParams.clusterConeWeights) {
+        Params candidate = params;
+        candidate.maxVerticesPerCluster = clusterSize.maxVertices;
+        candidate.maxTrianglesPerCluster = clusterSize.maxTriangles;
+        candidate.targetClustersPerGroup = targetClustersPerGroup;
+        candidate.clusterConeWeight = clusterConeWeight;
+        candidate.threadPoolSize = std::max(autotuneParams.threadPoolSize, static_cast<size_t>(1));
+        candidateParams.emplace_back(candidate);
+      }
+    }
+  }
+  if (candidateParams.empty()) {
+    throw std::runtime_error("could not autotune params: no candidates");
+  }
+
+  const auto sample = sampleMesh(indices, vertices, vertexStride, autotuneParams.maxSampleTriangles);
+
+  // candidates are built one at a time, so that their build times aren't skewed by other candidates competing for the same cores
+  AutotuneResult result{};
+  result.candidates.reserve(candidateParams.size());
+  for (const auto& candidate : candidateParams) {
+    result.candidates.emplace_back(evaluateCandidate(sample, vertexStride, candidate, autotuneParams));
+  }
+
+  // both costs are normalized by the cheapest candidate, so that their weights don't depend on the input's size
+  double minRuntimeCost = std::numeric_limits<double>::max();
+  double minBuildMilliseconds = std::numeric_limits<double>::max();
+  for (const auto& candidate : result.candidates) {
+    minRuntimeCost = std::min(minRuntimeCost, candidate.runtimeCost);
+    minBuildMilliseconds = std::min(minBuildMilliseconds, candidate.buildMilliseconds);
+  }
+  minRuntimeCost = std::max(minRuntimeCost, 1.0);
+  minBuildMilliseconds = std::max(minBuildMilliseconds, 1.0);
+
+  size_t bestCandidate = 0;
+  for (size_t i = 0; i < result.candidates.size(); ++i) {
+    auto& candidate = result.candidates[i];
+    candidate.cost = candidate.runtimeCost / minRuntimeCost + autotuneParams.buildTimeWeight * candidate.buildMilliseconds / minBuildMilliseconds;
+    if (candidate.cost < result.candidates[bestCandidate].cost) {
+      bestCandidate = i;
+    }
+  }
+
+  result.params = result.candidates[bestCandidate].params;
+  result.params.threadPoolSize = params.threadPoolSize;
+  return std::move(result);
+}
+}  // namespace trichi
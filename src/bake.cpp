@@ -0,0 +1,175 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "bake.hpp"
+
+constexpr std::array<char, 4> kBakeMagic = {'T', 'R', 'B', 'K'};
+constexpr uint32_t kBakeFormatVersion = 1;
+
+/**
+ * A file on its way through the bake pipeline.
+ * Files that failed in an earlier stage only carry their error.
+ */
+struct BakeJob {
+  const BakeFile* file = nullptr;
+  LoadedMesh mesh{};
+  std::vector<uint8_t> hierarchy{};
+  size_t triangles = 0;
+  size_t clusters = 0;
+  double loadMilliseconds = 0.0;
+  double buildMilliseconds = 0.0;
+  std::string error{};
+};
+
+[[nodiscard]] double millisecondsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Writes a baked file to a temporary file first, so that an interrupted bake never leaves a partial output behind.
+ *
+ * @return Returns the number of bytes written.
+ */
+size_t writeBakedFile(const BakeJob& job, std::vector<char>& writeBuffer) {
+  const auto& path = job.file->output;
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path());
+  }
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+
+  const uint64_t vertexStride = 6 * sizeof(float);
+  const uint64_t vertexFloats = job.mesh.vertices.size();
+  const uint64_t hierarchySize = job.hierarchy.size();
+  try {
+    {
+      std::ofstream stream{};
+      stream.rdbuf()->pubsetbuf(writeBuffer.data(), static_cast<std::streamsize>(writeBuffer.size()));
+      stream.open(temporaryPath, std::ios::binary | std::ios::trunc);
+      stream.write(kBakeMagic.data(), kBakeMagic.size());
+      stream.write(reinterpret_cast<const char*>(&kBakeFormatVersion), sizeof(kBakeFormatVersion));
+      stream.write(reinterpret_cast<const char*>(&vertexStride), sizeof(vertexStride));
+      stream.write(reinterpret_cast<const char*>(&vertexFloats), sizeof(vertexFloats));
+      stream.write(reinterpret_cast<const char*>(job.mesh.vertices.data()), static_cast<std::streamsize>(vertexFloats * sizeof(float)));
+      stream.write(reinterpret_cast<const char*>(&hierarchySize), sizeof(hierarchySize));
+      stream.write(reinterpret_cast<const char*>(job.hierarchy.data()), static_cast<std::streamsize>(hierarchySize));
+      if (!stream.flush()) {
+        throw std::runtime_error("could not write " + temporaryPath.string());
+      }
+    }
+    std::filesystem::rename(temporaryPath, path);
+  } catch (const std::exception&) {
+    std::error_code error{};
+    std::filesystem::remove(temporaryPath, error);
+    throw;
+  }
+  return kBakeMagic.size() + sizeof(kBakeFormatVersion) + sizeof(vertexStride) + sizeof(vertexFloats) + vertexFloats * sizeof(float) + sizeof(hierarchySize) + hierarchySize;
+}
+
+BakeStatistics bakeFiles(const std::vector<BakeFile>& files, const std::function<LoadedMesh(const std::filesystem::path&)>& load, const BakeOptions& options) {
+  const auto startTime = std::chrono::steady_clock::now();
+  BoundedQueue<BakeJob> loadedJobs{options.queueCapacity};
+  BoundedQueue<BakeJob> bakedJobs{options.queueCapacity};
+
+  std::atomic_size_t nextFile = 0;
+  std::vector<std::thread> loaders{};
+  for (size_t i = 0; i < std::max(options.loadThreads, static_cast<size_t>(1)); ++i) {
+    loaders.emplace_back([&] {
+      for (size_t fileIndex = nextFile++; fileIndex < files.size(); fileIndex = nextFile++) {
+        BakeJob job{.file = &files[fileIndex]};
+        const auto loadStartTime = std::chrono::steady_clock::now();
+        try {
+          job.mesh = load(job.file->input);
+        } catch (const std::exception& error) {
+          job.error = error.what();
+          bakedJobs.push(std::move(job));
+          continue;
+        }
+        job.loadMilliseconds = millisecondsSince(loadStartTime);
+        loadedJobs.push(std::move(job));
+      }
+    });
+  }
+
+  std::vector<std::thread> builders{};
+  for (size_t i = 0; i < std::max(options.buildThreads, static_cast<size_t>(1)); ++i) {
+    builders.emplace_back([&] {
+      while (auto job = loadedJobs.pop()) {
+        const auto buildStartTime = std::chrono::steady_clock::now();
+        try {
+          constexpr size_t vertexStride = 6 * sizeof(float);
+          auto hierarchy = options.cacheDirectory.empty()
+              ? trichi::buildClusterHierarchy(job->mesh.indices, job->mesh.submeshes, job->mesh.vertices, vertexStride, options.params)
+              : trichi::buildClusterHierarchyCached(job->mesh.indices, job->mesh.submeshes, job->mesh.vertices, vertexStride, options.params, trichi::CacheParams{
+                  .directory = options.cacheDirectory,
+                  .statistics = options.cacheStatistics,
+                });
+          if (options.reorderVertices) {
+            (void)trichi::reorderVertices(hierarchy, job->mesh.vertices, vertexStride, trichi::VertexReorderParams{
+                .threadPoolSize = options.params.threadPoolSize,
+            });
+          }
+          job->clusters = hierarchy.clusters.size();
+          job->hierarchy = trichi::serializeClusterHierarchy(hierarchy);
+        } catch (const std::exception& error) {
+          job->error = error.what();
+        }
+        // the indices are not part of the output, so they are released before the job waits for the writer
+        job->triangles = job->mesh.indices.size() / 3;
+        job->mesh.indices = {};
+        job->buildMilliseconds = millisecondsSince(buildStartTime);
+        bakedJobs.push(std::move(*job));
+      }
+    });
+  }
+
+  BakeStatistics statistics{};
+  std::thread writer([&] {
+    std::vector<char> writeBuffer(std::max(options.writeBufferSize, static_cast<size_t>(1)));
+    while (auto job = bakedJobs.pop()) {
+      const auto& input = job->file->input;
+      ++statistics.files;
+      if (job->error.empty()) {
+        const auto writeStartTime = std::chrono::steady_clock::now();
+        try {
+          const size_t bytesWritten = writeBakedFile(*job, writeBuffer);
+          const double writeMilliseconds = millisecondsSince(writeStartTime);
+          statistics.triangles += job->triangles;
+          statistics.bytesRead += job->mesh.fileSizeBytes;
+          statistics.bytesWritten += bytesWritten;
+          std::cout << input.string() << ": " << job->mesh.vertices.size() / 6 << " vertices, " << job->triangles << " triangles, " << job->clusters << " clusters, "
+                    << bytesWritten << " bytes; load " << job->loadMilliseconds << " ms, build " << job->buildMilliseconds
+                    << " ms, write " << writeMilliseconds << " ms\n";
+          continue;
+        } catch (const std::exception& error) {
+          job->error = error.what();
+        }
+      }
+      ++statistics.failedFiles;
+      std::cerr << input.string() << ": " << job->error << "\n";
+    }
+  });
+
+  for (auto& loader : loaders) {
+    loader.join();
+  }
+  loadedJobs.close();
+  for (auto& builder : builders) {
+    builder.join();
+  }
+  bakedJobs.close();
+  writer.join();
+
+  statistics.seconds = millisecondsSince(startTime) / 1000.0;
+  return statistics;
+}
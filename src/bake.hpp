@@ -0,0 +1,156 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#ifndef TRICHI_BAKE_HPP
+#define TRICHI_BAKE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "trichi.hpp"
+
+#include "loaders.hpp"
+
+/**
+ * A queue that blocks producers while it is full and consumers while it is empty, so that pipeline stages can't run ahead of each other.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(const size_t capacity) : capacity(std::max(capacity, static_cast<size_t>(1))) {}
+
+  /**
+   * Waits until the queue has room for another value and appends it.
+   */
+  void push(T value) {
+    std::unique_lock lock(mutex);
+    notFull.wait(lock, [this] { return values.size() < capacity; });
+    values.emplace_back(std::move(value));
+    notEmpty.notify_one();
+  }
+
+  /**
+   * Waits until the queue has a value and removes it.
+   *
+   * @return Returns the queue's first value, or nothing if the queue has been closed and is empty.
+   */
+  [[nodiscard]] std::optional<T> pop() {
+    std::unique_lock lock(mutex);
+    notEmpty.wait(lock, [this] { return !values.empty() || closed; });
+    if (values.empty()) {
+      return std::nullopt;
+    }
+    T value = std::move(values.front());
+    values.pop_front();
+    notFull.notify_one();
+    return value;
+  }
+
+  /**
+   * Signals that no more values are pushed, so that consumers stop waiting once the queue is empty.
+   */
+  void close() {
+    std::lock_guard lock(mutex);
+    closed = true;
+    notEmpty.notify_all();
+  }
+
+ private:
+  size_t capacity;
+  std::deque<T> values{};
+  bool closed = false;
+  std::mutex mutex{};
+  std::condition_variable notFull{};
+  std::condition_variable notEmpty{};
+};
+
+/**
+ * A file to bake and the path of its output.
+ */
+struct BakeFile {
+  std::filesystem::path input{};
+  std::filesystem::path output{};
+};
+
+struct BakeOptions {
+  /**
+   * The parameters for building each hierarchy.
+   * `Params::threadPoolSize` is the number of threads used by each build.
+   */
+  trichi::Params params{};
+
+  /**
+   * The number of files loaded at the same time.
+   */
+  size_t loadThreads = 2;
+
+  /**
+   * The number of hierarchies built at the same time.
+   */
+  size_t buildThreads = 1;
+
+  /**
+   * The number of loaded meshes & baked files that may wait for the next stage.
+   */
+  size_t queueCapacity = 4;
+
+  /**
+   * The size of each output file's write buffer in bytes.
+   */
+  size_t writeBufferSize = 8 * 1024 * 1024;
+
+  /**
+   * If not empty, hierarchies are cached in this directory (see `buildClusterHierarchyCached`).
+   */
+  std::string cacheDirectory{};
+
+  /**
+   * If set, the cache's statistics are accumulated here.
+   */
+  trichi::CacheStatistics* cacheStatistics = nullptr;
+
+  /**
+   * If true, each output's vertices are reordered by first use in cluster order (see `reorderVertices`).
+   */
+  bool reorderVertices = false;
+};
+
+struct BakeStatistics {
+  size_t files = 0;
+  size_t failedFiles = 0;
+  size_t triangles = 0;
+  size_t bytesRead = 0;
+  size_t bytesWritten = 0;
+  double seconds = 0.0;
+};
+
+/**
+ * Bakes files to trichi's binary bake format, overlapping loading, building & writing files.
+ *
+ * Files are loaded by `BakeOptions::loadThreads` threads, built by `BakeOptions::buildThreads` threads, and written by a single thread.
+ * The stages are connected by bounded queues, so that at most a few loaded meshes and baked files are in memory at the same time.
+ * Files that fail to load or build are reported and skipped.
+ * Each file's statistics are printed once it has been written.
+ *
+ * A baked file stores the magic number "TRBK", a 32-bit format version, the vertex stride in bytes and the number of floats in the vertex array as 64-bit integers,
+ * the vertex array, the size of the serialized hierarchy in bytes as a 64-bit integer, and the hierarchy serialized by `serializeClusterHierarchy`.
+ * All values are stored in native byte order.
+ *
+ * @param files the files to bake
+ * @param load loads a file
+ * @param options options for baking the files
+ * @return Returns the bake's statistics.
+ */
+[[nodiscard]] BakeStatistics bakeFiles(const std::vector<BakeFile>& files, const std::function<LoadedMesh(const std::filesystem::path&)>& load, const BakeOptions& options);
+
+#endif  //TRICHI_BAKE_HPP
@@ -0,0 +1,167 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Computes a triangle's unit normal.
+ * @return Returns false if the triangle is degenerate.
+ */
+[[nodiscard]] bool computeTriangleNormal(const float* a, const float* b, const float* c, float* normal) {
+  const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+  normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+  normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+  const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+  if (length == 0.0f) {
+    return false;
+  }
+  normal[0] /= length;
+  normal[1] /= length;
+  normal[2] /= length;
+  return true;
+}
+
+GroupBounds computeGroupBounds(
+    const std::vector<ClusterIndex>& clusterIndices,
+    const Buffers& buffers,
+    const std::span<const uint32_t> group,
+    const std::vector<float>& vertices,
+    const size_t vertexStride) {
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  const auto position = [&](const uint32_t vertexIndex) {
+    return &vertices[vertexIndex * floatsPerVertex];
+  };
+  const auto forEachVertex = [&](auto&& body) {
+    for (const uint32_t groupClusterIndex : group) {
+      const auto& cluster = buffers.clusters[clusterIndices[groupClusterIndex]];
+      for (size_t i = 0; i < cluster.vertexCount; ++i) {
+        body(position(buffers.vertices[cluster.vertexOffset + i]));
+      }
+    }
+  };
+  const auto forEachTriangle = [&](auto&& body) {
+    for (const uint32_t groupClusterIndex : group) {
+      const auto& cluster = buffers.clusters[clusterIndices[groupClusterIndex]];
+      const unsigned int* clusterVertices = &buffers.vertices[cluster.vertexOffset];
+      const unsigned char* clusterTriangles = &buffers.triangles[cluster.triangleOffset];
+      for (size_t i = 0; i < cluster.triangleCount; ++i) {
+        body(
+            position(clusterVertices[clusterTriangles[i * 3 + 0]]),
+            position(clusterVertices[clusterTriangles[i * 3 + 1]]),
+            position(clusterVertices[clusterTriangles[i * 3 + 2]]));
+      }
+    }
+  };
+
+  GroupBounds bounds{};
+
+  // the aabb and the extreme points along each axis as the starting point for Ritter's bounding sphere
+  const float* minPoints[3] = {nullptr, nullptr, nullptr};
+  const float* maxPoints[3] = {nullptr, nullptr, nullptr};
+  for (size_t axis = 0; axis < 3; ++axis) {
+    bounds.aabbMin[axis] = std::numeric_limits<float>::max();
+    bounds.aabbMax[axis] = std::numeric_limits<float>::lowest();
+  }
+  forEachVertex([&](const float* p) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      if (p[axis] < bounds.aabbMin[axis]) {
+        bounds.aabbMin[axis] = p[axis];
+        minPoints[axis] = p;
+      }
+      if (p[axis] > bounds.aabbMax[axis]) {
+        bounds.aabbMax[axis] = p[axis];
+        maxPoints[axis] = p;
+      }
+    }
+  });
+  if (!minPoints[0]) {
+    return bounds;
+  }
+
+  const auto squaredDistance = [](const float* a, const float* b) {
+    return (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]);
+  };
+  size_t sphereAxis = 0;
+  for (size_t axis = 1; axis < 3; ++axis) {
+    if (squaredDistance(minPoints[axis], maxPoints[axis]) > squaredDistance(minPoints[sphereAxis], maxPoints[sphereAxis])) {
+      sphereAxis = axis;
+    }
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    bounds.center[i] = (minPoints[sphereAxis][i] + maxPoints[sphereAxis][i]) * 0.5f;
+  }
+  bounds.radius = std::sqrt(squaredDistance(minPoints[sphereAxis], maxPoints[sphereAxis])) * 0.5f;
+  forEachVertex([&](const float* p) {
+    const float distance = std::sqrt(squaredDistance(p, bounds.center));
+    if (distance > bounds.radius) {
+      const float radius = (bounds.radius + distance) * 0.5f;
+      const float shift = (distance - radius) / distance;
+      for (size_t i = 0; i < 3; ++i) {
+        bounds.center[i] += (p[i] - bounds.center[i]) * shift;
+      }
+      bounds.radius = radius;
+    }
+  });
+
+  // the normal cone is computed like meshopt_computeClusterBounds does for a single cluster
+  float axis[3] = {0.0f, 0.0f, 0.0f};
+  size_t numTriangles = 0;
+  forEachTriangle([&](const float* a, const float* b, const float* c) {
+    float normal[3];
+    if (computeTriangleNormal(a, b, c, normal)) {
+      axis[0] += normal[0];
+      axis[1] += normal[1];
+      axis[2] += normal[2];
+      ++numTriangles;
+    }
+  });
+  const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  if (numTriangles == 0 || axisLength == 0.0f) {
+    return bounds;
+  }
+  axis[0] /= axisLength;
+  axis[1] /= axisLength;
+  axis[2] /= axisLength;
+
+  float minDot = 1.0f;
+  forEachTriangle([&](const float* a, const float* b, const float* c) {
+    float normal[3];
+    if (computeTriangleNormal(a, b, c, normal)) {
+      minDot = std::min(minDot, normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]);
+    }
+  });
+
+  // the cone is too wide to be useful
+  if (minDot <= 0.1f) {
+    return bounds;
+  }
+
+  // the apex must lie behind all triangles
+  float maxT = 0.0f;
+  forEachTriangle([&](const float* a, const float* b, const float* c) {
+    float normal[3];
+    if (computeTriangleNormal(a, b, c, normal)) {
+      const float dc = (bounds.center[0] - a[0]) * normal[0] + (bounds.center[1] - a[1]) * normal[1] + (bounds.center[2] - a[2]) * normal[2];
+      const float dn = axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2];
+      maxT = std::max(maxT, dc / dn);
+    }
+  });
+
+  for (size_t i = 0; i < 3; ++i) {
+    bounds.normalCone.apex[i] = bounds.center[i] - axis[i] * maxT;
+    bounds.normalCone.axis[i] = axis[i];
+  }
+  bounds.normalCone.cutoff = std::sqrt(1.0f - minDot * minDot);
+
+  return bounds;
+}
+}  // namespace trichi
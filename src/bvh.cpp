@@ -0,0 +1,301 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Clusters that are kept in the same BVH leaf, i.e., all clusters created from the same cluster group or a single cluster of the first level.
+ */
+struct BvhUnit {
+  size_t firstCluster = 0;
+  size_t clusterCount = 0;
+  float centroid[3]{};
+};
+
+/**
+ * Grows a sphere to enclose another sphere.
+ */
+void enclose(float* center, float& radius, const float* otherCenter, const float otherRadius) {
+  const float d[3] = {otherCenter[0] - center[0], otherCenter[1] - center[1], otherCenter[2] - center[2]};
+  const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  if (distance + otherRadius <= radius) {
+    return;
+  }
+  if (distance + radius <= otherRadius) {
+    std::copy_n(otherCenter, 3, center);
+    radius = otherRadius;
+    return;
+  }
+  const float enclosingRadius = (distance + radius + otherRadius) * 0.5f;
+  const float shift = (enclosingRadius - radius) / distance;
+  center[0] += d[0] * shift;
+  center[1] += d[1] * shift;
+  center[2] += d[2] * shift;
+  radius = enclosingRadius;
+}
+
+/**
+ * Grows a BVH node's bounds to enclose the given culling sphere & parent error bounds.
+ */
+void enclose(BvhNode& node, const bool isFirst, const float* center, const float radius, const ErrorBounds& parentError) {
+  if (isFirst) {
+    std::copy_n(center, 3, node.center);
+    node.radius = radius;
+    node.maxParentError = parentError;
+    return;
+  }
+  enclose(node.center, node.radius, center, radius);
+  enclose(node.maxParentError.center, node.maxParentError.radius, parentError.center, parentError.radius);
+  node.maxParentError.error = std::max(node.maxParentError.error, parentError.error);
+}
+
+class BvhBuilder {
+ public:
+  BvhBuilder(const ClusterHierarchy& hierarchy, ClusterBvh& bvh) : hierarchy(hierarchy), bvh(bvh) {}
+
+  void build() {
+    const size_t numClusters = hierarchy.nodes.size();
+    if (numClusters == 0) {
+      return;
+    }
+
+    const auto [clusterUnits, unitLevels, unitSizes] = computeClusterUnits(hierarchy);
+    const size_t numLevels = *std::max_element(unitLevels.cbegin(), unitLevels.cend()) + 1;
+
+    // units are sorted by level, so that each level's units are contiguous
+    levelOffsets.assign(numLevels + 1, 0);
+    for (const size_t level : unitLevels) {
+      ++levelOffsets[level + 1];
+    }
+    for (size_t level = 0; level < numLevels; ++level) {
+      levelOffsets[level + 1] += levelOffsets[level];
+    }
+    std::vector<size_t> unitSlots(unitSizes.size());
+    std::vector<size_t> nextSlots(levelOffsets.cbegin(), levelOffsets.cend() - 1);
+    std::vector<BvhUnit> units(unitSizes.size());
+    for (size_t unit = 0; unit < units.size(); ++unit) {
+      unitSlots[unit] = nextSlots[unitLevels[unit]]++;
+      units[unitSlots[unit]].clusterCount = unitSizes[unit];
+    }
+
+    // the clusters of each unit are stored contiguously
+    size_t clusterOffset = 0;
+    for (auto& unit : units) {
+      unit.firstCluster = clusterOffset;
+      clusterOffset += unit.clusterCount;
+      unit.clusterCount = 0;
+    }
+    unitClusters.resize(numClusters);
+    for (size_t i = 0; i < numClusters; ++i) {
+      auto& unit = units[unitSlots[clusterUnits[i]]];
+      unitClusters[unit.firstCluster + unit.clusterCount++] = i;
+      const auto& bounds = hierarchy.bounds[i];
+      unit.centroid[0] += bounds.center[0];
+      unit.centroid[1] += bounds.center[1];
+      unit.centroid[2] += bounds.center[2];
+    }
+    for (auto& unit : units) {
+      unit.centroid[0] /= static_cast<float>(unit.clusterCount);
+      unit.centroid[1] /= static_cast<float>(unit.clusterCount);
+      unit.centroid[2] /= static_cast<float>(unit.clusterCount);
+    }
+
+    bvh.nodes.emplace_back();
+    bvh.clusterIndices.reserve(numClusters);
+    buildLevels(0, 0, numLevels, units);
+  }
+
+ private:
+  /**
+   * Builds a subtree for each level in [firstLevel, lastLevel) and joins them in the node at the given slot.
+   */
+  void buildLevels(const size_t slot, const size_t firstLevel, const size_t lastLevel, std::span<BvhUnit> units) {
+    const size_t numLevels = lastLevel - firstLevel;
+    if (numLevels == 1) {
+      buildNode(slot, units.subspan(levelOffsets[firstLevel], levelOffsets[lastLevel] - levelOffsets[firstLevel]));
+      return;
+    }
+
+    const size_t numChildren = std::min(numLevels, kBvhWidth);
+    const size_t firstChild = bvh.nodes.size();
+    bvh.nodes.resize(firstChild + numChildren);
+    for (size_t i = 0; i < numChildren; ++i) {
+      buildLevels(firstChild + i, firstLevel + numLevels * i / numChildren, firstLevel + numLevels * (i + 1) / numChildren, units);
+    }
+    joinChildren(slot, firstChild, numChildren);
+  }
+
+  /**
+   * Builds the subtree for the given units in the node at the given slot.
+   * Units are split at the median of their centroids along the axis of largest extent until at most `kBvhWidth` partitions remain.
+   */
+  void buildNode(const size_t slot, const std::span<BvhUnit> units) {
+    size_t numClusters = 0;
+    for (const auto& unit : units) {
+      numClusters += unit.clusterCount;
+    }
+    if (units.size() == 1 || numClusters <= kBvhWidth) {
+      buildLeaf(slot, units);
+      return;
+    }
+
+    std::vector<std::span<BvhUnit>> partitions{units};
+    while (partitions.size() < kBvhWidth) {
+      const auto largest = std::max_element(partitions.begin(), partitions.end(), [](const auto& a, const auto& b) {
+        return a.size() < b.size();
+      });
+      if (largest->size() <= 1) {
+        break;
+      }
+      const auto partition = *largest;
+      const size_t median = partition.size() / 2;
+      const size_t axis = largestAxis(partition);
+      std::nth_element(partition.begin(), partition.begin() + static_cast<ptrdiff_t>(median), partition.end(), [axis](const BvhUnit& a, const BvhUnit& b) {
+        return a.centroid[axis] < b.centroid[axis];
+      });
+      *largest = partition.first(median);
+      partitions.emplace_back(partition.subspan(median));
+    }
+
+    const size_t firstChild = bvh.nodes.size();
+    bvh.nodes.resize(firstChild + partitions.size());
+    for (size_t i = 0; i < partitions.size(); ++i) {
+      buildNode(firstChild + i, partitions[i]);
+    }
+    joinChildren(slot, firstChild, partitions.size());
+  }
+
+  void buildLeaf(const size_t slot, const std::span<const BvhUnit> units) {
+    BvhNode node{};
+    node.isLeaf = true;
+    node.firstChild = static_cast<uint32_t>(bvh.clusterIndices.size());
+    for (const auto& unit : units) {
+      for (size_t i = 0; i < unit.clusterCount; ++i) {
+        const size_t clusterIndex = unitClusters[unit.firstCluster + i];
+        const auto& bounds = hierarchy.bounds[clusterIndex];
+        enclose(node, node.childCount == 0, bounds.center, bounds.radius, hierarchy.errors[clusterIndex].parentError);
+        bvh.clusterIndices.emplace_back(clusterIndex);
+        ++node.childCount;
+      }
+    }
+    bvh.nodes[slot] = node;
+  }
+
+  void joinChildren(const size_t slot, const size_t firstChild, const size_t numChildren) {
+    BvhNode node{};
+    node.firstChild = static_cast<uint32_t>(firstChild);
+    node.childCount = static_cast<uint32_t>(numChildren);
+    for (size_t i = 0; i < numChildren; ++i) {
+      const auto& child = bvh.nodes[firstChild + i];
+      enclose(node, i == 0, child.center, child.radius, child.maxParentError);
+    }
+    bvh.nodes[slot] = node;
+  }
+
+  [[nodiscard]] static size_t largestAxis(const std::span<const BvhUnit> units) {
+    float min[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float max[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const auto& unit : units) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        min[axis] = std::min(min[axis], unit.centroid[axis]);
+        max[axis] = std::max(max[axis], unit.centroid[axis]);
+      }
+    }
+    size_t largest = 0;
+    for (size_t axis = 1; axis < 3; ++axis) {
+      if (max[axis] - min[axis] > max[largest] - min[largest]) {
+        largest = axis;
+      }
+    }
+    return largest;
+  }
+
+  const ClusterHierarchy& hierarchy;
+  ClusterBvh& bvh;
+  std::vector<size_t> unitClusters{};
+  std::vector<size_t> levelOffsets{};
+};
+
+ClusterBvh buildClusterBvh(const ClusterHierarchy& hierarchy) {
+  ClusterBvh bvh{};
+  BvhBuilder{hierarchy, bvh}.build();
+  return std::move(bvh);
+}
+
+void traverseClusterBvh(const ClusterBvh& bvh, const std::function<bool(const BvhNode&)>& visitNode, const std::function<void(size_t)>& visitCluster) {
+  if (bvh.nodes.empty()) {
+    return;
+  }
+  std::vector<uint32_t> stack = {0};
+  while (!stack.empty()) {
+    const auto& node = bvh.nodes[stack.back()];
+    stack.pop_back();
+    if (!visitNode(node)) {
+      continue;
+    }
+    if (node.isLeaf) {
+      for (size_t i = 0; i < node.childCount; ++i) {
+        visitCluster(bvh.clusterIndices[node.firstChild + i]);
+      }
+    } else {
+      for (uint32_t i = node.childCount; i > 0; --i) {
+        stack.emplace_back(node.firstChild + i - 1);
+      }
+    }
+  }
+}
+
+[[nodiscard]] bool isCulled(const float* center, const float radius, const ViewParams& view) {
+  return std::any_of(view.cullingPlanes.cbegin(), view.cullingPlanes.cend(), [&](const auto& plane) {
+    return plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -radius;
+  });
+}
+
+/**
+ * Projects an error from the point of its bounds closest to the camera.
+ * The projected error is infinite if the camera is inside the bounds.
+ */
+[[nodiscard]] float projectError(const ErrorBounds& bounds, const ViewParams& view) {
+  const float d[3] = {
+      bounds.center[0] - view.cameraPosition[0],
+      bounds.center[1] - view.cameraPosition[1],
+      bounds.center[2] - view.cameraPosition[2],
+  };
+  const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - bounds.radius;
+  if (distance <= 0.0f || bounds.error == std::numeric_limits<float>::max()) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return bounds.error * view.projectionScale / distance;
+}
+
+bool isClusterSelected(const ClusterHierarchy& hierarchy, const size_t clusterIndex, const ViewParams& view) {
+  const auto& bounds = hierarchy.bounds[clusterIndex];
+  const auto& errors = hierarchy.errors[clusterIndex];
+  return !isCulled(bounds.center, bounds.radius, view) &&
+         projectError(errors.clusterError, view) <= view.errorThreshold &&
+         projectError(errors.parentError, view) > view.errorThreshold;
+}
+
+std::vector<size_t> selectClusters(const ClusterHierarchy& hierarchy, const ClusterBvh& bvh, const ViewParams& view) {
+  std::vector<size_t> selectedClusters{};
+  traverseClusterBvh(
+      bvh,
+      [&](const BvhNode& node) {
+        return !isCulled(node.center, node.radius, view) && projectError(node.maxParentError, view) > view.errorThreshold;
+      },
+      [&](const size_t clusterIndex) {
+        if (isClusterSelected(hierarchy, clusterIndex, view)) {
+          selectedClusters.emplace_back(clusterIndex);
+        }
+      });
+  return std::move(selectedClusters);
+}
+}  // namespace trichi
@@ -0,0 +1,241 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <bit>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRICHI_CACHE_MMAP
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close
+#endif  //defined(__unix__) || defined(__APPLE__)
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "trichi.hpp"
+
+namespace trichi {
+// bump this whenever the output of buildClusterHierarchy changes for the same input
+constexpr uint64_t kCacheVersion = 4;
+
+/**
+ * A read-only view of a file's contents.
+ * Uses mmap where available and falls back to reading the whole file otherwise.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path) {
+#ifdef TRICHI_CACHE_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+      void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        mappedData = static_cast<const uint8_t*>(mapped);
+        mappedSize = static_cast<size_t>(fileStat.st_size);
+      }
+    }
+    close(fd);
+#else
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) {
+      return;
+    }
+    buffer.resize(static_cast<size_t>(stream.tellg()));
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+      buffer.clear();
+    }
+#endif  //TRICHI_CACHE_MMAP
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+#ifdef TRICHI_CACHE_MMAP
+    if (mappedData) {
+      munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+    }
+#endif  //TRICHI_CACHE_MMAP
+  }
+
+  [[nodiscard]] const uint8_t* data() const {
+#ifdef TRICHI_CACHE_MMAP
+    return mappedData;
+#else
+    return buffer.data();
+#endif  //TRICHI_CACHE_MMAP
+  }
+
+  [[nodiscard]] size_t size() const {
+#ifdef TRICHI_CACHE_MMAP
+    return mappedSize;
+#else
+    return buffer.size();
+#endif  //TRICHI_CACHE_MMAP
+  }
+
+ private:
+#ifdef TRICHI_CACHE_MMAP
+  const uint8_t* mappedData = nullptr;
+  size_t mappedSize = 0;
+#else
+  std::vector<uint8_t> buffer{};
+#endif  //TRICHI_CACHE_MMAP
+};
+
+uint64_t computeCacheKey(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const Params& params) {
+  return computeCacheKey(indices, {Submesh{.firstIndex = 0, .indexCount = indices.size(), .materialId = 0}}, vertices, vertexStride, params);
+}
+
+uint64_t computeCacheKey(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, const size_t vertexStride, const Params& params) {
+  XXH3_state_t state{};
+  XXH3_64bits_reset_withSeed(&state, kCacheVersion);
+
+  // only parameters that affect the result are part of the key, e.g., the thread pool size is not (see Params::seed)
+  const uint64_t paramValues[] = {
+      static_cast<uint64_t>(vertexStride),
+      static_cast<uint64_t>(params.maxVerticesPerCluster),
+      static_cast<uint64_t>(params.maxTrianglesPerCluster),
+      static_cast<uint64_t>(std::bit_cast<uint32_t>(params.clusterConeWeight)),
+      static_cast<uint64_t>(params.targetClustersPerGroup),
+      static_cast<uint64_t>(params.maxHierarchyDepth),
+      static_cast<uint64_t>(params.seed),
+      static_cast<uint64_t>(params.deferClusterOptimization),
+      static_cast<uint64_t>(params.partitionRegions),
+      static_cast<uint64_t>(params.sortClustersSpatially),
+      static_cast<uint64_t>(indices.size()),
+      static_cast<uint64_t>(vertices.size()),
+      static_cast<uint64_t>(submeshes.size()),
+  };
+  XXH3_64bits_update(&state, paramValues, sizeof(paramValues));
+  for (const auto& submesh : submeshes) {
+    const uint64_t submeshValues[] = {
+        static_cast<uint64_t>(submesh.firstIndex),
+        static_cast<uint64_t>(submesh.indexCount),
+        static_cast<uint64_t>(submesh.materialId),
+    };
+    XXH3_64bits_update(&state, submeshValues, sizeof(submeshValues));
+  }
+  XXH3_64bits_update(&state, indices.data(), indices.size() * sizeof(uint32_t));
+
+  // other vertex attributes don't affect the hierarchy, so only positions are hashed
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  if (floatsPerVertex == 3) {
+    XXH3_64bits_update(&state, vertices.data(), vertices.size() * sizeof(float));
+  } else if (floatsPerVertex > 3) {
+    constexpr size_t chunkSize = 1024;
+    float positions[chunkSize * 3];
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    for (size_t first = 0; first < vertexCount; first += chunkSize) {
+      const size_t count = std::min(chunkSize, vertexCount - first);
+      for (size_t i = 0; i < count; ++i) {
+        const float* position = &vertices[(first + i) * floatsPerVertex];
+        positions[i * 3 + 0] = position[0];
+        positions[i * 3 + 1] = position[1];
+        positions[i * 3 + 2] = position[2];
+      }
+      XXH3_64bits_update(&state, positions, count * 3 * sizeof(float));
+    }
+  }
+  return XXH3_64bits_digest(&state);
+}
+
+[[nodiscard]] std::filesystem::path cacheEntryPath(const std::filesystem::path& directory, const uint64_t key) {
+  char fileName[32];
+  std::snprintf(fileName, sizeof(fileName), "%016llx.trichi", static_cast<unsigned long long>(key));
+  return directory / fileName;
+}
+
+[[nodiscard]] bool loadCacheEntry(const std::filesystem::path& path, ClusterHierarchy& hierarchy, CacheStatistics* statistics) {
+  const MappedFile file{path};
+  if (file.size() == 0) {
+    return false;
+  }
+  try {
+    hierarchy = deserializeClusterHierarchy(file.data(), file.size());
+  } catch (const std::runtime_error&) {
+    // a corrupt or outdated entry is treated like a miss and overwritten
+    return false;
+  }
+  if (statistics) {
+    statistics->bytesRead += file.size();
+  }
+  return true;
+}
+
+/**
+ * Stores a hierarchy in the cache.
+ * A failed write only costs a future cache miss, so errors are counted instead of thrown and the temporary file is removed.
+ */
+void storeCacheEntry(const std::filesystem::path& path, const ClusterHierarchy& hierarchy, CacheStatistics* statistics) {
+  // write to a temporary file first, so that concurrent builds never see partially written entries
+  // thread ids are only unique within a process, so the name also gets a random suffix for processes sharing the cache
+  std::random_device randomDevice{};
+  const uint64_t suffix = (static_cast<uint64_t>(randomDevice()) << 32) ^ randomDevice() ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+  char suffixString[32];
+  std::snprintf(suffixString, sizeof(suffixString), ".%016llx.tmp", static_cast<unsigned long long>(suffix));
+  auto temporaryPath = path;
+  temporaryPath += suffixString;
+  try {
+    const auto bytes = serializeClusterHierarchy(hierarchy);
+    std::filesystem::create_directories(path.parent_path());
+    {
+      std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+      if (!stream.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())) || !stream.flush()) {
+        throw std::runtime_error("could not write cache entry " + temporaryPath.string());
+      }
+    }
+    std::filesystem::rename(temporaryPath, path);
+
+    if (statistics) {
+      statistics->bytesWritten += bytes.size();
+    }
+  } catch (const std::exception&) {
+    std::error_code error{};
+    std::filesystem::remove(temporaryPath, error);
+    if (statistics) {
+      ++statistics->writeFailures;
+    }
+  }
+}
+
+ClusterHierarchy buildClusterHierarchyCached(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const Params& params, const CacheParams& cacheParams) {
+  return buildClusterHierarchyCached(indices, {Submesh{.firstIndex = 0, .indexCount = indices.size(), .materialId = 0}}, vertices, vertexStride, params, cacheParams);
+}
+
+ClusterHierarchy buildClusterHierarchyCached(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, const size_t vertexStride, const Params& params, const CacheParams& cacheParams) {
+  const std::filesystem::path directory = cacheParams.directory;
+  const auto path = cacheEntryPath(directory, computeCacheKey(indices, submeshes, vertices, vertexStride, params));
+
+  ClusterHierarchy hierarchy{};
+  if (loadCacheEntry(path, hierarchy, cacheParams.statistics)) {
+    if (cacheParams.statistics) {
+      ++cacheParams.statistics->hits;
+    }
+    return std::move(hierarchy);
+  }
+  if (cacheParams.statistics) {
+    ++cacheParams.statistics->misses;
+  }
+
+  hierarchy = buildClusterHierarchy(indices, submeshes, vertices, vertexStride, params);
+  storeCacheEntry(path, hierarchy, cacheParams.statistics);
+
+  return std::move(hierarchy);
+}
+}  // namespace trichi
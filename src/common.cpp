@@ -3,54 +3,274 @@
 * SPDX-License-Identifier: MIT
 */
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+
 #include "meshoptimizer.h"
 
 #include "impl.hpp"
 
 namespace trichi {
-[[nodiscard]] std::unordered_map<uint64_t, int> extractClusterEdges(const ClusterIndex& clusterIndex, const Buffers& buffers) {
-  const auto& cluster = buffers.clusters[clusterIndex.index];
-  std::unordered_map<uint64_t, int> edges{};
+size_t extractBoundary(const ClusterIndex clusterIndex, const Buffers& buffers, uint64_t* boundary) {
+  const auto& cluster = buffers.clusters[clusterIndex];
+  return extractBoundary(cluster, &buffers.vertices[cluster.vertexOffset], &buffers.triangles[cluster.triangleOffset], boundary);
+}
+
+/**
+ * Extracts a cluster's boundary by sorting all of its edges.
+ * This works for clusters of any size up to kMaxTrianglesPerCluster triangles.
+ */
+size_t extractBoundarySorted(const Cluster& cluster, const unsigned int* clusterVertices, const unsigned char* clusterTriangles, uint64_t* boundary) {
+  const size_t numEdges = cluster.triangleCount * 3;
+
+  // a cluster has at most kMaxTrianglesPerCluster * 3 edges, so they fit on the stack
+  std::array<uint64_t, kMaxTrianglesPerCluster * 3> edges;
+  if (numEdges > edges.size()) {
+    throw std::runtime_error("too many triangles in cluster");
+  }
+
   for (size_t i = 0; i < cluster.triangleCount; ++i) {
-    const size_t triangle_offset = cluster.triangleOffset + i * 3;
-    const uint32_t a =
-        buffers.vertices[cluster.vertexOffset + buffers.triangles[triangle_offset + 0]];
-    const uint32_t b =
-        buffers.vertices[cluster.vertexOffset + buffers.triangles[triangle_offset + 1]];
-    const uint32_t c =
-        buffers.vertices[cluster.vertexOffset + buffers.triangles[triangle_offset + 2]];
-    if (auto [edge, inserted] = edges.try_emplace(packSorted(a, b), 1); !inserted) {
-      ++(edge->second);
-    }
-    if (auto [edge, inserted] = edges.try_emplace(packSorted(a, c), 1); !inserted) {
-      ++(edge->second);
+    const uint32_t a = clusterVertices[clusterTriangles[i * 3 + 0]];
+    const uint32_t b = clusterVertices[clusterTriangles[i * 3 + 1]];
+    const uint32_t c = clusterVertices[clusterTriangles[i * 3 + 2]];
+    edges[i * 3 + 0] = packSorted(a, b);
+    edges[i * 3 + 1] = packSorted(a, c);
+    edges[i * 3 + 2] = packSorted(b, c);
+  }
+
+  // sorting brings duplicates next to each other & leaves the boundary sorted for later use of set_intersection
+  std::sort(edges.begin(), edges.begin() + static_cast<ptrdiff_t>(numEdges));
+
+  // find boundary = find edges that only appear once
+  size_t boundarySize = 0;
+  for (size_t i = 0; i < numEdges;) {
+    size_t next = i + 1;
+    while (next < numEdges && edges[next] == edges[i]) {
+      ++next;
     }
-    if (auto [edge, inserted] = edges.try_emplace(packSorted(b, c), 1); !inserted) {
-      ++(edge->second);
+    if (next - i == 1) {
+      boundary[boundarySize++] = edges[i];
     }
+    i = next;
   }
-  return std::move(edges);
+  return boundarySize;
 }
 
-void extractBoundary(const ClusterIndex& clusterIndex, const Buffers& buffers, std::vector<uint64_t>& boundary) {
-  // find edges
-  const auto edges = extractClusterEdges(clusterIndex, buffers);
+/**
+ * Extracts the boundary of a cluster with at most `MaxVertices` vertices.
+ * Instead of sorting all edges, edges are counted in a dense table indexed by the cluster's local vertex indices, so that only the boundary edges have to be sorted.
+ * For common cluster sizes, the table is small enough to live on the stack.
+ */
+template <size_t MaxVertices>
+size_t extractBoundaryCounted(const Cluster& cluster, const unsigned int* clusterVertices, const unsigned char* clusterTriangles, uint64_t* boundary) {
+  // counts saturate at 2, since only edges that appear exactly once are boundary edges
+  std::array<uint8_t, MaxVertices * MaxVertices> edgeCounts{};
+  const auto localEdge = [](const unsigned char a, const unsigned char b) {
+    return a < b ? a * MaxVertices + b : b * MaxVertices + a;
+  };
 
-  // find boundary = find edges that only appear once
-  for (const auto& [edgeId, numOccurrences] : edges) {
-    if (numOccurrences == 1) {
-      boundary.push_back(edgeId);
+  const size_t numIndices = cluster.triangleCount * 3;
+  for (size_t i = 0; i < numIndices; i += 3) {
+    const unsigned char a = clusterTriangles[i + 0];
+    const unsigned char b = clusterTriangles[i + 1];
+    const unsigned char c = clusterTriangles[i + 2];
+    for (const size_t edge : {localEdge(a, b), localEdge(a, c), localEdge(b, c)}) {
+      edgeCounts[edge] += edgeCounts[edge] < 2 ? 1 : 0;
     }
   }
 
-  // sort boundary for later use of set_union
-  std::sort(boundary.begin(), boundary.end());
+  size_t boundarySize = 0;
+  for (size_t i = 0; i < numIndices; i += 3) {
+    const unsigned char a = clusterTriangles[i + 0];
+    const unsigned char b = clusterTriangles[i + 1];
+    const unsigned char c = clusterTriangles[i + 2];
+    if (edgeCounts[localEdge(a, b)] == 1) {
+      boundary[boundarySize++] = packSorted(clusterVertices[a], clusterVertices[b]);
+    }
+    if (edgeCounts[localEdge(a, c)] == 1) {
+      boundary[boundarySize++] = packSorted(clusterVertices[a], clusterVertices[c]);
+    }
+    if (edgeCounts[localEdge(b, c)] == 1) {
+      boundary[boundarySize++] = packSorted(clusterVertices[b], clusterVertices[c]);
+    }
+  }
+
+  // the boundary is sorted like `extractBoundarySorted`'s for later use of set_intersection
+  std::sort(boundary, boundary + boundarySize);
+  return boundarySize;
+}
+
+size_t extractBoundary(const Cluster& cluster, const unsigned int* clusterVertices, const unsigned char* clusterTriangles, uint64_t* boundary) {
+  if (cluster.triangleCount > kMaxTrianglesPerCluster) {
+    throw std::runtime_error("too many triangles in cluster");
+  }
+  // almost all clusters are built for mesh shaders with at most 64 or 128 vertices
+  if (cluster.vertexCount <= 64) {
+    return extractBoundaryCounted<64>(cluster, clusterVertices, clusterTriangles, boundary);
+  }
+  if (cluster.vertexCount <= 128) {
+    return extractBoundaryCounted<128>(cluster, clusterVertices, clusterTriangles, boundary);
+  }
+  return extractBoundarySorted(cluster, clusterVertices, clusterTriangles, boundary);
 }
 
-[[nodiscard]] std::vector<std::vector<uint64_t>> extractBoundaries(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner) {
-  std::vector<std::vector<uint64_t>> boundaries(clusterIndices.size());
-  loopRunner.loop(0, clusterIndices.size(), [&clusterIndices, &buffers, &boundaries](const size_t i) { extractBoundary(clusterIndices[i], buffers, boundaries[i]); });
+ClusterBoundaries extractBoundaries(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner) {
+  ClusterBoundaries boundaries{
+      .edges = {},
+      .offsets = std::vector<size_t>(clusterIndices.size()),
+      .sizes = std::vector<uint32_t>(clusterIndices.size()),
+  };
+
+  // each cluster gets a slot for all of its edges, so the parallel pass doesn't need to allocate
+  size_t numEdges = 0;
+  for (size_t i = 0; i < clusterIndices.size(); ++i) {
+    boundaries.offsets[i] = numEdges;
+    numEdges += buffers.clusters[clusterIndices[i]].triangleCount * 3;
+  }
+  boundaries.edges.resize(numEdges);
+
+  loopRunner.loop(0, clusterIndices.size(), [&clusterIndices, &buffers, &boundaries](const size_t i) {
+    boundaries.sizes[i] = static_cast<uint32_t>(extractBoundary(clusterIndices[i], buffers, &boundaries.edges[boundaries.offsets[i]]));
+  });
   return std::move(boundaries);
 }
 
-}  // namespace trichi
\ No newline at end of file
+std::vector<size_t> computeNodeLevels(const ClusterHierarchy& hierarchy) {
+  // a node's children always come before the node itself in the hierarchy
+  std::vector<size_t> levels(hierarchy.nodes.size(), 0);
+  for (size_t i = 0; i < hierarchy.nodes.size(); ++i) {
+    for (const size_t child : hierarchy.nodes[i].childNodeIndices) {
+      levels[i] = std::max(levels[i], levels[child] + 1);
+    }
+  }
+  return std::move(levels);
+}
+
+ClusterUnits computeClusterUnits(const ClusterHierarchy& hierarchy) {
+  const size_t numClusters = hierarchy.nodes.size();
+  const auto levels = computeNodeLevels(hierarchy);
+  size_t numGroups = 0;
+  for (const auto& node : hierarchy.nodes) {
+    if (!node.childNodeIndices.empty()) {
+      numGroups = std::max(numGroups, node.childGroupIndex + 1);
+    }
+  }
+
+  // clusters created from the same group form a unit, all other clusters are units on their own
+  constexpr size_t kNoUnit = std::numeric_limits<size_t>::max();
+  std::vector<size_t> groupUnits(numGroups, kNoUnit);
+  ClusterUnits units{};
+  units.clusterUnits.resize(numClusters);
+  for (size_t i = 0; i < numClusters; ++i) {
+    const auto& node = hierarchy.nodes[i];
+    size_t unit = node.childNodeIndices.empty() ? kNoUnit : groupUnits[node.childGroupIndex];
+    if (unit == kNoUnit) {
+      unit = units.unitSizes.size();
+      units.unitSizes.emplace_back(0);
+      units.unitLevels.emplace_back(levels[i]);
+      if (!node.childNodeIndices.empty()) {
+        groupUnits[node.childGroupIndex] = unit;
+      }
+    }
+    units.clusterUnits[i] = unit;
+    ++units.unitSizes[unit];
+  }
+  return std::move(units);
+}
+
+/**
+ * Spreads the lower 10 bits of a value such that there are two zero bits between each pair of bits.
+ */
+[[nodiscard]] constexpr uint32_t spreadBits(uint32_t x) {
+  x &= 0x000003ff;
+  x = (x ^ (x << 16)) & 0xff0000ff;
+  x = (x ^ (x << 8)) & 0x0300f00f;
+  x = (x ^ (x << 4)) & 0x030c30c3;
+  x = (x ^ (x << 2)) & 0x09249249;
+  return x;
+}
+
+/**
+ * Sorts values by their keys using a stable least significant digit radix sort.
+ * The keys are split into fixed-size chunks that are histogrammed & scattered in parallel, so the result doesn't depend on the number of threads.
+ */
+void radixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, const size_t keyBits, LoopRunner& loopRunner) {
+  constexpr size_t kDigitBits = 8;
+  constexpr size_t kNumBuckets = 1 << kDigitBits;
+  constexpr size_t kChunkSize = 16384;
+
+  const size_t numChunks = (keys.size() + kChunkSize - 1) / kChunkSize;
+  std::vector<uint32_t> sortedKeys(keys.size());
+  std::vector<uint32_t> sortedValues(values.size());
+  std::vector<size_t> chunkOffsets(numChunks * kNumBuckets);
+  for (size_t shift = 0; shift < keyBits; shift += kDigitBits) {
+    std::fill(chunkOffsets.begin(), chunkOffsets.end(), 0);
+    loopRunner.loop(0, numChunks, [&](const size_t chunk) {
+      const size_t end = std::min((chunk + 1) * kChunkSize, keys.size());
+      for (size_t i = chunk * kChunkSize; i < end; ++i) {
+        ++chunkOffsets[chunk * kNumBuckets + ((keys[i] >> shift) & (kNumBuckets - 1))];
+      }
+    });
+
+    // each chunk's slots for a digit come after all previous digits' & previous chunks' slots for the same digit
+    size_t offset = 0;
+    for (size_t digit = 0; digit < kNumBuckets; ++digit) {
+      for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+        const size_t count = chunkOffsets[chunk * kNumBuckets + digit];
+        chunkOffsets[chunk * kNumBuckets + digit] = offset;
+        offset += count;
+      }
+    }
+
+    loopRunner.loop(0, numChunks, [&](const size_t chunk) {
+      const size_t end = std::min((chunk + 1) * kChunkSize, keys.size());
+      for (size_t i = chunk * kChunkSize; i < end; ++i) {
+        const size_t slot = chunkOffsets[chunk * kNumBuckets + ((keys[i] >> shift) & (kNumBuckets - 1))]++;
+        sortedKeys[slot] = keys[i];
+        sortedValues[slot] = values[i];
+      }
+    });
+    keys.swap(sortedKeys);
+    values.swap(sortedValues);
+  }
+}
+
+std::vector<uint32_t> computeMortonOrder(const std::vector<ClusterBounds>& clusterBounds, const size_t first, LoopRunner& loopRunner) {
+  const size_t numClusters = clusterBounds.size() - first;
+
+  float aabbMin[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+  float aabbMax[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+  for (size_t i = first; i < clusterBounds.size(); ++i) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      aabbMin[axis] = std::min(aabbMin[axis], clusterBounds[i].center[axis]);
+      aabbMax[axis] = std::max(aabbMax[axis], clusterBounds[i].center[axis]);
+    }
+  }
+
+  // the centers are quantized to 10 bits per axis relative to their common bounding box
+  constexpr float kMaxQuantized = 1023.0f;
+  float scale[3]{};
+  for (size_t axis = 0; axis < 3; ++axis) {
+    const float extent = aabbMax[axis] - aabbMin[axis];
+    scale[axis] = extent > 0.0f ? kMaxQuantized / extent : 0.0f;
+  }
+
+  std::vector<uint32_t> keys(numClusters);
+  std::vector<uint32_t> order(numClusters);
+  loopRunner.loop(0, numClusters, [&](const size_t i) {
+    const auto& center = clusterBounds[first + i].center;
+    uint32_t code = 0;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const float quantized = std::clamp((center[axis] - aabbMin[axis]) * scale[axis], 0.0f, kMaxQuantized);
+      code |= spreadBits(static_cast<uint32_t>(quantized)) << (2 - axis);
+    }
+    keys[i] = code;
+    order[i] = static_cast<uint32_t>(i);
+  });
+  radixSort(keys, order, 30, loopRunner);
+  return std::move(order);
+}
+
+}  // namespace trichi
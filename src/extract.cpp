@@ -0,0 +1,108 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Collects the indices of all clusters in the hierarchy for which `isSelected` returns true in ascending order.
+ */
+template <typename Predicate>
+[[nodiscard]] std::vector<size_t> collectClusters(const ClusterHierarchy& hierarchy, Predicate&& isSelected, LoopRunner& loopRunner) {
+  std::vector<uint8_t> selected(hierarchy.clusters.size(), 0);
+  loopRunner.loop(0, hierarchy.clusters.size(), [&](const size_t clusterIndex) {
+    selected[clusterIndex] = isSelected(clusterIndex) ? 1 : 0;
+  });
+  std::vector<size_t> clusterIndices{};
+  for (size_t clusterIndex = 0; clusterIndex < selected.size(); ++clusterIndex) {
+    if (selected[clusterIndex]) {
+      clusterIndices.emplace_back(clusterIndex);
+    }
+  }
+  return std::move(clusterIndices);
+}
+
+[[nodiscard]] ExtractedMesh extractClusters(const ClusterHierarchy& hierarchy, const std::vector<size_t>& clusterIndices, const ExtractionParams& params, LoopRunner& loopRunner) {
+  for (const size_t clusterIndex : clusterIndices) {
+    if (clusterIndex >= hierarchy.clusters.size()) {
+      throw std::runtime_error("could not extract mesh: invalid cluster index");
+    }
+  }
+
+  // each cluster's first triangle in the extracted mesh
+  std::vector<size_t> firstTriangles(clusterIndices.size() + 1, 0);
+  for (size_t i = 0; i < clusterIndices.size(); ++i) {
+    firstTriangles[i + 1] = firstTriangles[i] + hierarchy.clusters[clusterIndices[i]].triangleCount;
+  }
+
+  ExtractedMesh mesh{};
+  mesh.indices.resize(firstTriangles.back() * 3);
+  if (params.emitClusterRanges) {
+    mesh.clusterRanges.resize(clusterIndices.size());
+  }
+  loopRunner.loop(0, clusterIndices.size(), [&](const size_t i) {
+    const auto& cluster = hierarchy.clusters[clusterIndices[i]];
+    const uint32_t* clusterVertices = &hierarchy.vertices[cluster.vertexOffset];
+    const uint8_t* clusterTriangles = &hierarchy.triangles[cluster.triangleOffset];
+    uint32_t* indices = &mesh.indices[firstTriangles[i] * 3];
+    for (size_t j = 0; j < cluster.triangleCount * 3; ++j) {
+      indices[j] = clusterVertices[clusterTriangles[j]];
+    }
+    if (params.emitClusterRanges) {
+      mesh.clusterRanges[i] = ClusterRange{
+          .clusterIndex = clusterIndices[i],
+          .firstTriangle = firstTriangles[i],
+          .triangleCount = cluster.triangleCount,
+      };
+    }
+  });
+
+  if (params.compactVertices && !mesh.indices.empty()) {
+    // vertices are numbered in order of first use, which keeps them close to the triangles referencing them
+    const uint32_t maxVertexIndex = *std::max_element(mesh.indices.cbegin(), mesh.indices.cend());
+    std::vector<uint32_t> remap(static_cast<size_t>(maxVertexIndex) + 1, std::numeric_limits<uint32_t>::max());
+    for (uint32_t& index : mesh.indices) {
+      if (remap[index] == std::numeric_limits<uint32_t>::max()) {
+        remap[index] = static_cast<uint32_t>(mesh.vertices.size());
+        mesh.vertices.emplace_back(index);
+      }
+      index = remap[index];
+    }
+  }
+
+  return std::move(mesh);
+}
+
+ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, const std::vector<size_t>& clusterIndices, const ExtractionParams& params) {
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  return extractClusters(hierarchy, clusterIndices, params, loopRunner);
+}
+
+ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, const float maxError, const ExtractionParams& params) {
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  const auto clusterIndices = collectClusters(
+      hierarchy,
+      [&](const size_t clusterIndex) {
+        const auto& errors = hierarchy.errors[clusterIndex];
+        return errors.clusterError.error <= maxError && errors.parentError.error > maxError;
+      },
+      loopRunner);
+  return extractClusters(hierarchy, clusterIndices, params, loopRunner);
+}
+
+ExtractedMesh extractMesh(const ClusterHierarchy& hierarchy, const ViewParams& view, const ExtractionParams& params) {
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  const auto clusterIndices = collectClusters(
+      hierarchy,
+      [&](const size_t clusterIndex) {
+        return isClusterSelected(hierarchy, clusterIndex, view);
+      },
+      loopRunner);
+  return extractClusters(hierarchy, clusterIndices, params, loopRunner);
+}
+}  // namespace trichi
@@ -6,7 +6,10 @@
 #ifndef TRICHI_IMPL_HPP
 #define TRICHI_IMPL_HPP
 
-#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <span>
 #include <vector>
 
 #include "meshoptimizer.h"
@@ -21,22 +24,370 @@ struct Buffers {
   std::vector<unsigned char> triangles;
 };
 
-struct ClusterIndex {
-  size_t index{};
-  size_t lod{};
+/**
+ * Scratch buffers for building clusters that are reused across calls.
+ * They only grow, so each thread allocates them once for all cluster groups of similar size.
+ */
+struct ClusterScratch {
+  std::vector<meshopt_Meshlet> meshlets;
+  std::vector<unsigned int> vertices;
+  std::vector<unsigned char> triangles;
+};
+
+/**
+ * The index of a cluster in `Buffers::clusters`.
+ */
+using ClusterIndex = uint32_t;
+
+/**
+ * Marks nodes without children in `buildClusterHierarchy`'s internal node representation and the child group of discarded nodes.
+ */
+constexpr uint32_t kNoChildren = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Groups of indices stored in a single flat array (CSR).
+ * The indices of the i-th group are `indices[offsets[i]]` to `indices[offsets[i + 1]]` (exclusive).
+ */
+struct IndexGroups {
+  std::vector<uint32_t> offsets = {0};
+  std::vector<uint32_t> indices{};
+
+  [[nodiscard]] size_t size() const { return offsets.size() - 1; }
+
+  [[nodiscard]] std::span<const uint32_t> operator[](const size_t i) const {
+    return {indices.data() + offsets[i], indices.data() + offsets[i + 1]};
+  }
+
+  template <typename Range>
+  void append(const Range& group) {
+    indices.insert(indices.cend(), group.begin(), group.end());
+    offsets.emplace_back(static_cast<uint32_t>(indices.size()));
+  }
+};
+
+/**
+ * Checks whether a build should be aborted (see `Params::cancellationToken`).
+ * Can be queried concurrently from multiple threads.
+ */
+class BuildMonitor {
+ public:
+  explicit BuildMonitor(const Params& params)
+      : cancellationToken(params.cancellationToken),
+        deadline(
+            params.timeLimitMilliseconds > 0
+                ? std::chrono::steady_clock::now() + std::chrono::milliseconds(params.timeLimitMilliseconds)
+                : std::chrono::steady_clock::time_point::max()),
+        memoryBudget(params.memoryBudgetBytes > 0 ? params.memoryBudgetBytes : std::numeric_limits<size_t>::max()) {}
+
+  /**
+   * Once this returns true, it returns true for all subsequent calls.
+   *
+   * @param memoryUsage the estimated number of bytes used by the build so far
+   * @return Returns true if the build should be aborted.
+   */
+  [[nodiscard]] bool shouldAbort(const size_t memoryUsage = 0) {
+    if (status.load(std::memory_order_relaxed) != kRunning) {
+      return true;
+    }
+    if (cancellationToken && cancellationToken->load(std::memory_order_relaxed)) {
+      abort(AbortReason::Cancelled);
+    } else if (std::chrono::steady_clock::now() >= deadline) {
+      abort(AbortReason::TimeLimitExceeded);
+    } else if (memoryUsage > memoryBudget) {
+      abort(AbortReason::MemoryBudgetExceeded);
+    }
+    return status.load(std::memory_order_relaxed) != kRunning;
+  }
+
+  /**
+   * Only valid after `shouldAbort` returned true.
+   *
+   * @return Returns the reason the build was aborted.
+   */
+  [[nodiscard]] AbortReason reason() const { return static_cast<AbortReason>(status.load() - 1); }
+
+ private:
+  static constexpr int kRunning = 0;
+
+  void abort(const AbortReason reason) {
+    int expected = kRunning;
+    status.compare_exchange_strong(expected, static_cast<int>(reason) + 1);
+  }
+
+  const std::atomic_bool* cancellationToken;
+  std::chrono::steady_clock::time_point deadline;
+  size_t memoryBudget;
+  std::atomic_int status = kRunning;
+};
+
+/**
+ * The maximum number of triangles per cluster supported by meshoptimizer's `meshopt_buildMeshlets`.
+ */
+constexpr size_t kMaxTrianglesPerCluster = 512;
+
+/**
+ * Sorted boundary edges (see `packSorted`) of clusters, stored in a single flat array.
+ * Each cluster's boundary occupies a slot large enough to store all its edges.
+ */
+struct ClusterBoundaries {
+  std::vector<uint64_t> edges{};
+  std::vector<size_t> offsets{};
+  std::vector<uint32_t> sizes{};
+
+  [[nodiscard]] size_t size() const { return sizes.size(); }
+
+  [[nodiscard]] std::span<const uint64_t> operator[](const size_t i) const {
+    return {edges.data() + offsets[i], edges.data() + offsets[i] + sizes[i]};
+  }
+};
+
+/**
+ * Appends clusters to the given buffers and offsets their vertices & triangles accordingly.
+ */
+void appendClusters(Buffers& buffers, Buffers&& clusters);
+
+/**
+ * Optimizes the vertex & triangle order within the given clusters for locality.
+ */
+void optimizeClusters(Buffers& buffers, size_t firstCluster, size_t lastCluster);
+
+/**
+ * Creates a single group containing all `size` clusters of a level.
+ */
+[[nodiscard]] IndexGroups buildFinalClusterGroup(size_t size);
+
+/**
+ * Positions are only packed into a separate stream if the input's vertices contain more than a padded position.
+ */
+constexpr size_t kMinPackedPositionsStride = 4 * sizeof(float);
+
+/**
+ * Positions are only packed into a separate stream if the input's vertices don't fit into a typical L2 cache anyway.
+ */
+constexpr size_t kMinPackedPositionsBytes = 1024 * 1024;
+
+/**
+ * Checks if packing the input's positions into a separate stream pays off, i.e., if it saves more memory traffic in all build stages than copying the positions once costs.
+ */
+[[nodiscard]] constexpr bool shouldPackPositions(const size_t vertexCount, const size_t vertexStride) {
+  return vertexStride > kMinPackedPositionsStride && vertexCount * vertexStride >= kMinPackedPositionsBytes;
+}
+
+/**
+ * Copies the first three floats of each vertex into a packed stream of positions.
+ */
+[[nodiscard]] std::vector<float> packPositions(const std::vector<float>& vertices, size_t vertexCount, size_t vertexStride, LoopRunner& loopRunner);
+
+/**
+ * Computes the bounds of a cluster without children, i.e., a cluster on level 0.
+ * Its error is 0 and its parent error is reset, so that it is a root until it is grouped.
+ */
+void computeLeafClusterBounds(
+    const Buffers& buffers,
+    size_t clusterIndex,
+    const std::vector<float>& vertices,
+    size_t vertexCount,
+    size_t vertexStride,
+    NodeErrorBounds& errorBounds,
+    ClusterBounds& bounds);
+
+/**
+ * The result of simplifying a cluster group: the group's new parent clusters and their metadata.
+ * If the group could not be simplified, `clusters` is empty and the group's clusters are carried over to the next level.
+ */
+struct SimplifiedGroup {
+  Buffers clusters{};
+  std::vector<uint32_t> materials{};
+  std::vector<NodeErrorBounds> errorBounds{};
+  std::vector<ClusterBounds> clusterBounds{};
+
+  /**
+   * The error bounds all of the group's clusters get as their parent error.
+   */
+  ErrorBounds groupErrorBounds{};
+  GroupBounds groupBounds{};
 };
 
-[[nodiscard]] std::unordered_map<uint64_t, int> extractClusterEdges(const ClusterIndex& clusterIndex, const Buffers& buffers);
+/**
+ * Merges, simplifies & re-clusters a cluster group.
+ *
+ * @param group the group's indices into `clusterIndices`
+ * @param clusterIndices the indices of the clusters the group indexes into
+ * @param buffers the buffers containing the clusters
+ * @param clusterMaterials the material of each cluster in `buffers`
+ * @param nodeErrorBounds the error bounds of each cluster in `buffers`
+ * @param vertices the input mesh's vertices
+ * @param vertexCount the number of vertices
+ * @param vertexStride the size of each vertex in the vertices array
+ * @param params the parameters the hierarchy is built with
+ * @return Returns the group's parent clusters.
+ */
+[[nodiscard]] SimplifiedGroup simplifyClusterGroup(
+    std::span<const uint32_t> group,
+    const std::vector<ClusterIndex>& clusterIndices,
+    const Buffers& buffers,
+    const std::vector<uint32_t>& clusterMaterials,
+    const std::vector<NodeErrorBounds>& nodeErrorBounds,
+    const std::vector<float>& vertices,
+    size_t vertexCount,
+    size_t vertexStride,
+    const Params& params);
+
+/**
+ * Extracts a cluster's boundary, i.e., all edges that belong to only one of its triangles.
+ * Does not allocate.
+ *
+ * @param clusterIndex the cluster's index
+ * @param buffers the buffers containing the cluster
+ * @param boundary receives the sorted boundary edges, must be large enough to store all of the cluster's edges
+ * @return Returns the number of boundary edges.
+ */
+size_t extractBoundary(ClusterIndex clusterIndex, const Buffers& buffers, uint64_t* boundary);
 
-void extractBoundary(const ClusterIndex& clusterIndex, const Buffers& buffers, std::vector<uint64_t>& boundary);
+/**
+ * Extracts a cluster's boundary from the given vertex index and triangle arrays (see `extractBoundary`).
+ */
+size_t extractBoundary(const Cluster& cluster, const unsigned int* vertices, const unsigned char* triangles, uint64_t* boundary);
 
-[[nodiscard]] std::vector<std::vector<uint64_t>> extractBoundaries(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner);
+[[nodiscard]] ClusterBoundaries extractBoundaries(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner);
 
-[[nodiscard]] std::vector<std::vector<size_t>> groupClusters(
+/**
+ * Computes tight bounds of all triangles in a cluster group.
+ *
+ * @param clusterIndices the indices of the clusters the group indexes into
+ * @param buffers the buffers containing the clusters
+ * @param group the group's indices into `clusterIndices`
+ * @param vertices the input mesh's vertices
+ * @param vertexStride the size of each vertex in the vertices array
+ * @return Returns the group's bounds.
+ */
+[[nodiscard]] GroupBounds computeGroupBounds(
     const std::vector<ClusterIndex>& clusterIndices,
     const Buffers& buffers,
+    std::span<const uint32_t> group,
+    const std::vector<float>& vertices,
+    size_t vertexStride);
+
+/**
+ * Groups clusters such that each group contains approximately `maxClustersPerGroup` connected clusters.
+ * If `numRegions` is greater than 1 and there are enough clusters, the clusters are split into spatial regions based on `clusterBounds` that are grouped in parallel (see `Params::partitionRegions`).
+ * The groups store indices into `clusterIndices`.
+ */
+[[nodiscard]] IndexGroups groupClusters(
+    const std::vector<ClusterIndex>& clusterIndices,
+    const Buffers& buffers,
+    const std::vector<ClusterBounds>& clusterBounds,
     const size_t maxClustersPerGroup,
+    const size_t numRegions,
+    const uint32_t seed,
+    LoopRunner& loopRunner);
+
+/**
+ * Continues building a cluster hierarchy from clusters without parents, e.g., after parts of it have been discarded or several hierarchies have been concatenated.
+ * The clusters in `levelClusters[i]` have been built on level i and are grouped & simplified together with the clusters of the same level like in `buildClusterHierarchy`.
+ * New clusters are appended to `buffers`, and their nodes & metadata to the hierarchy, whose own cluster, vertex & triangle arrays are not used.
+ *
+ * @return Returns the clusters that are still without parents afterward, i.e., the new roots.
+ */
+[[nodiscard]] std::vector<ClusterIndex> extendClusterHierarchy(
+    ClusterHierarchy& hierarchy,
+    Buffers& buffers,
+    const std::vector<std::vector<ClusterIndex>>& levelClusters,
+    const std::vector<float>& vertices,
+    size_t vertexCount,
+    size_t vertexStride,
+    const Params& params,
     LoopRunner& loopRunner);
+
+/**
+ * Computes the level of each node in a cluster hierarchy, where a node's level is one more than its highest child's and nodes without children are on level 0.
+ */
+[[nodiscard]] std::vector<size_t> computeNodeLevels(const ClusterHierarchy& hierarchy);
+
+/**
+ * Clusters that are always streamed & culled together, i.e., all clusters created from the same cluster group or a single cluster of the first level.
+ * Units are numbered in the order of their first cluster.
+ */
+struct ClusterUnits {
+  /**
+   * The unit of each cluster, indexed by cluster index.
+   */
+  std::vector<size_t> clusterUnits{};
+
+  /**
+   * The level of each unit's clusters (see `computeNodeLevels`).
+   */
+  std::vector<size_t> unitLevels{};
+
+  /**
+   * The number of clusters in each unit.
+   */
+  std::vector<size_t> unitSizes{};
+};
+
+/**
+ * Groups the clusters of a cluster hierarchy into units.
+ */
+[[nodiscard]] ClusterUnits computeClusterUnits(const ClusterHierarchy& hierarchy);
+
+/**
+ * Sorts the clusters starting at `first` by the Morton code of their bounds' centers.
+ *
+ * @return Returns the new order as indices relative to `first`, i.e., the i-th cluster in the new order is `first + order[i]`.
+ */
+[[nodiscard]] std::vector<uint32_t> computeMortonOrder(const std::vector<ClusterBounds>& clusterBounds, size_t first, LoopRunner& loopRunner);
+
+/**
+ * A page of a streamed cluster hierarchy.
+ */
+struct StreamingPage {
+  size_t sizeBytes = 0;
+
+  /**
+   * The lowest level of all clusters in the page, where level 0 contains the most detailed clusters.
+   */
+  size_t level = std::numeric_limits<size_t>::max();
+};
+
+/**
+ * The pages of a unit (see `ClusterUnits`).
+ */
+struct StreamingUnit {
+  size_t firstPage = 0;
+  size_t pageCount = 0;
+};
+
+/**
+ * Splits a cluster hierarchy into pages.
+ */
+class StreamingLayout {
+ public:
+  StreamingLayout(const ClusterHierarchy& hierarchy, const StreamingParams& params);
+
+  /**
+   * @return Returns the first page of the given cluster's unit.
+   */
+  [[nodiscard]] size_t firstPage(const size_t clusterIndex) const { return units[clusterUnits[clusterIndex]].firstPage; }
+
+  template <typename Body>
+  void forEachPage(const size_t clusterIndex, Body&& body) const {
+    const auto& unit = units[clusterUnits[clusterIndex]];
+    for (size_t page = unit.firstPage; page < unit.firstPage + unit.pageCount; ++page) {
+      body(page);
+    }
+  }
+
+  std::vector<StreamingPage> pages{};
+
+ private:
+  std::vector<size_t> clusterUnits{};
+  std::vector<StreamingUnit> units{};
+};
+
+/**
+ * Checks if a cluster is selected for a view, i.e., if it is not culled and its own projected error is within the view's error threshold but its parent group's is not.
+ */
+[[nodiscard]] bool isClusterSelected(const ClusterHierarchy& hierarchy, size_t clusterIndex, const ViewParams& view);
 }  // namespace trichi
 
 #endif  //TRICHI_IMPL_HPP
@@ -0,0 +1,338 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * A submesh with its vertices numbered in order of first use.
+ */
+struct LocalSubmesh {
+  std::vector<uint32_t> indices{};
+
+  /**
+   * The index of each of the submesh's vertices in the input mesh.
+   */
+  std::vector<uint32_t> vertices{};
+
+  double centroid[3] = {0.0, 0.0, 0.0};
+  double radius = 0.0;
+
+  /**
+   * The mean distance of the submesh's vertices to its centroid.
+   * Like `radius`, this doesn't change under rigid transforms, and it differs by at most the tolerance between duplicates.
+   */
+  double meanDistance = 0.0;
+
+  /**
+   * A hash of the submesh's material & triangles, which don't change under rigid transforms.
+   */
+  uint64_t hash = 0;
+};
+
+[[nodiscard]] LocalSubmesh extractLocalSubmesh(const std::vector<uint32_t>& indices, const Submesh& submesh, const std::vector<float>& vertices, const size_t floatsPerVertex) {
+  LocalSubmesh local{};
+  local.indices.reserve(submesh.indexCount);
+  std::unordered_map<uint32_t, uint32_t> localIndices{};
+  for (size_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; ++i) {
+    const auto [it, inserted] = localIndices.try_emplace(indices[i], static_cast<uint32_t>(local.vertices.size()));
+    if (inserted) {
+      local.vertices.emplace_back(indices[i]);
+    }
+    local.indices.emplace_back(it->second);
+  }
+
+  for (const uint32_t vertexIndex : local.vertices) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      local.centroid[axis] += vertices[vertexIndex * floatsPerVertex + axis];
+    }
+  }
+  for (double& c : local.centroid) {
+    c /= static_cast<double>(std::max(local.vertices.size(), static_cast<size_t>(1)));
+  }
+  for (const uint32_t vertexIndex : local.vertices) {
+    double distance = 0.0;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const double d = vertices[vertexIndex * floatsPerVertex + axis] - local.centroid[axis];
+      distance += d * d;
+    }
+    local.radius = std::max(local.radius, std::sqrt(distance));
+    local.meanDistance += std::sqrt(distance);
+  }
+  local.meanDistance /= static_cast<double>(std::max(local.vertices.size(), static_cast<size_t>(1)));
+
+  XXH3_state_t state{};
+  XXH3_64bits_reset_withSeed(&state, 0);
+  const uint64_t values[] = {static_cast<uint64_t>(submesh.materialId), static_cast<uint64_t>(local.vertices.size())};
+  XXH3_64bits_update(&state, values, sizeof(values));
+  XXH3_64bits_update(&state, local.indices.data(), local.indices.size() * sizeof(uint32_t));
+  local.hash = XXH3_64bits_digest(&state);
+  return std::move(local);
+}
+
+/**
+ * Computes the eigenvector of the largest eigenvalue of a symmetric 4x4 matrix using the cyclic Jacobi method.
+ */
+[[nodiscard]] std::array<double, 4> largestEigenvector(std::array<std::array<double, 4>, 4> a) {
+  std::array<std::array<double, 4>, 4> v{};
+  for (size_t i = 0; i < 4; ++i) {
+    v[i][i] = 1.0;
+  }
+  constexpr size_t kMaxSweeps = 50;
+  for (size_t sweep = 0; sweep < kMaxSweeps; ++sweep) {
+    double offDiagonal = 0.0;
+    for (size_t p = 0; p < 4; ++p) {
+      for (size_t q = p + 1; q < 4; ++q) {
+        offDiagonal += a[p][q] * a[p][q];
+      }
+    }
+    if (offDiagonal < 1e-30) {
+      break;
+    }
+    for (size_t p = 0; p < 4; ++p) {
+      for (size_t q = p + 1; q < 4; ++q) {
+        if (a[p][q] == 0.0) {
+          continue;
+        }
+        const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+        const double c = 1.0 / std::sqrt(t * t + 1.0);
+        const double s = t * c;
+        for (size_t k = 0; k < 4; ++k) {
+          const double akp = a[k][p];
+          const double akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (size_t k = 0; k < 4; ++k) {
+          const double apk = a[p][k];
+          const double aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (size_t k = 0; k < 4; ++k) {
+          const double vkp = v[k][p];
+          const double vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+  size_t largest = 0;
+  for (size_t i = 1; i < 4; ++i) {
+    if (a[i][i] > a[largest][largest]) {
+      largest = i;
+    }
+  }
+  return {v[0][largest], v[1][largest], v[2][largest], v[3][largest]};
+}
+
+/**
+ * Finds the rotation that best maps the centered positions of one submesh to another's, where vertices correspond by their local index.
+ * See Berthold K. P. Horn, "Closed-form solution of absolute orientation using unit quaternions".
+ *
+ * @return Returns the rotation as a row-major 3x3 matrix.
+ */
+[[nodiscard]] std::array<double, 9> alignSubmeshes(const LocalSubmesh& from, const LocalSubmesh& to, const std::vector<float>& vertices, const size_t floatsPerVertex) {
+  double s[3][3] = {};
+  for (size_t i = 0; i < from.vertices.size(); ++i) {
+    for (size_t a = 0; a < 3; ++a) {
+      const double p = vertices[from.vertices[i] * floatsPerVertex + a] - from.centroid[a];
+      for (size_t b = 0; b < 3; ++b) {
+        s[a][b] += p * (vertices[to.vertices[i] * floatsPerVertex + b] - to.centroid[b]);
+      }
+    }
+  }
+  const auto q = largestEigenvector({{
+      {s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1], s[2][0] - s[0][2], s[0][1] - s[1][0]},
+      {s[1][2] - s[2][1], s[0][0] - s[1][1] - s[2][2], s[0][1] + s[1][0], s[2][0] + s[0][2]},
+      {s[2][0] - s[0][2], s[0][1] + s[1][0], -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1]},
+      {s[0][1] - s[1][0], s[2][0] + s[0][2], s[1][2] + s[2][1], -s[0][0] - s[1][1] + s[2][2]},
+  }});
+  const double w = q[0];
+  const double x = q[1];
+  const double y = q[2];
+  const double z = q[3];
+  return {
+      w * w + x * x - y * y - z * z, 2.0 * (x * y - w * z), 2.0 * (x * z + w * y),
+      2.0 * (x * y + w * z), w * w - x * x + y * y - z * z, 2.0 * (y * z - w * x),
+      2.0 * (x * z - w * y), 2.0 * (y * z + w * x), w * w - x * x - y * y + z * z,
+  };
+}
+
+/**
+ * Checks if one submesh is a rigid transform of another and computes the transform if it is.
+ */
+[[nodiscard]] bool matchSubmeshes(
+    const LocalSubmesh& from,
+    const LocalSubmesh& to,
+    const std::vector<float>& vertices,
+    const size_t floatsPerVertex,
+    const float tolerance,
+    std::array<float, 12>& transform) {
+  if (from.indices != to.indices || from.vertices.size() != to.vertices.size()) {
+    return false;
+  }
+  const double maxDistance = static_cast<double>(tolerance) * std::max(from.radius, to.radius);
+  if (std::abs(from.radius - to.radius) > maxDistance || std::abs(from.meanDistance - to.meanDistance) > maxDistance) {
+    return false;
+  }
+
+  const auto r = alignSubmeshes(from, to, vertices, floatsPerVertex);
+  for (size_t i = 0; i < from.vertices.size(); ++i) {
+    const float* p = &vertices[from.vertices[i] * floatsPerVertex];
+    const float* q = &vertices[to.vertices[i] * floatsPerVertex];
+    double distance = 0.0;
+    for (size_t row = 0; row < 3; ++row) {
+      double transformed = to.centroid[row];
+      for (size_t column = 0; column < 3; ++column) {
+        transformed += r[row * 3 + column] * (p[column] - from.centroid[column]);
+      }
+      distance += (transformed - q[row]) * (transformed - q[row]);
+    }
+    if (distance > maxDistance * maxDistance) {
+      return false;
+    }
+  }
+
+  for (size_t row = 0; row < 3; ++row) {
+    double translation = to.centroid[row];
+    for (size_t column = 0; column < 3; ++column) {
+      transform[row * 4 + column] = static_cast<float>(r[row * 3 + column]);
+      translation -= r[row * 3 + column] * from.centroid[column];
+    }
+    transform[row * 4 + 3] = static_cast<float>(translation);
+  }
+  return true;
+}
+
+DeduplicatedSubmeshes deduplicateSubmeshes(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, const size_t vertexStride, const DeduplicationParams& params) {
+  if ((vertices.size() * sizeof(float)) % vertexStride != 0) {
+    throw std::runtime_error("invalid vertex stride");
+  }
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  const size_t vertexCount = vertices.size() / floatsPerVertex;
+  for (const auto& submesh : submeshes) {
+    if (submesh.indexCount % 3 != 0 || submesh.firstIndex > indices.size() || submesh.indexCount > indices.size() - submesh.firstIndex) {
+      throw std::runtime_error("invalid submesh");
+    }
+    for (size_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; ++i) {
+      if (indices[i] >= vertexCount) {
+        throw std::runtime_error("could not deduplicate submeshes: index out of range");
+      }
+    }
+  }
+
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  std::vector<LocalSubmesh> localSubmeshes(submeshes.size());
+  loopRunner.loop(0, submeshes.size(), [&](const size_t i) {
+    localSubmeshes[i] = extractLocalSubmesh(indices, submeshes[i], vertices, floatsPerVertex);
+  });
+
+  // submeshes with the same hash are candidates for duplicates, buckets are ordered by their first submesh
+  std::unordered_map<uint64_t, size_t> bucketIndices{};
+  std::vector<std::vector<uint32_t>> buckets{};
+  for (size_t i = 0; i < submeshes.size(); ++i) {
+    const auto [it, inserted] = bucketIndices.try_emplace(localSubmeshes[i].hash, buckets.size());
+    if (inserted) {
+      buckets.emplace_back();
+    }
+    buckets[it->second].emplace_back(static_cast<uint32_t>(i));
+  }
+
+  // within a bucket, each submesh is compared to the first submesh of each shape found so far whose radius is within the tolerance of its own
+  // shapes are looked up by radius, so that buckets of many distinct shapes with the same triangles aren't compared pairwise
+  DeduplicatedSubmeshes result{};
+  result.instances.resize(submeshes.size());
+  std::vector<uint32_t> firstSubmeshes(submeshes.size());
+  // duplicates' radii differ by at most `tolerance` times the larger radius
+  const double tolerance = std::max(static_cast<double>(params.tolerance), 0.0);
+  loopRunner.loop(0, buckets.size(), [&](const size_t bucket) {
+    std::multimap<double, uint32_t> shapeSubmeshes{};
+    std::vector<uint32_t> candidates{};
+    for (const uint32_t submeshIndex : buckets[bucket]) {
+      auto& instance = result.instances[submeshIndex];
+      const double radius = localSubmeshes[submeshIndex].radius;
+      const double maxRadius = tolerance < 1.0 ? radius / (1.0 - tolerance) : std::numeric_limits<double>::infinity();
+      candidates.clear();
+      for (auto it = shapeSubmeshes.lower_bound(radius * (1.0 - tolerance)); it != shapeSubmeshes.cend() && it->first <= maxRadius; ++it) {
+        candidates.emplace_back(it->second);
+      }
+      // shapes are tried in the order they were found, so that the result doesn't depend on their radii
+      std::sort(candidates.begin(), candidates.end());
+      const auto shape = std::find_if(candidates.cbegin(), candidates.cend(), [&](const uint32_t shapeSubmesh) {
+        return matchSubmeshes(localSubmeshes[shapeSubmesh], localSubmeshes[submeshIndex], vertices, floatsPerVertex, params.tolerance, instance.transform);
+      });
+      if (shape == candidates.cend()) {
+        shapeSubmeshes.emplace(radius, submeshIndex);
+        firstSubmeshes[submeshIndex] = submeshIndex;
+      } else {
+        firstSubmeshes[submeshIndex] = *shape;
+      }
+    }
+  });
+
+  // shapes are numbered in order of their first submesh
+  std::vector<size_t> shapeIndices(submeshes.size());
+  for (size_t i = 0; i < submeshes.size(); ++i) {
+    if (firstSubmeshes[i] == i) {
+      shapeIndices[i] = result.shapes.size();
+      const auto& local = localSubmeshes[i];
+      auto& shape = result.shapes.emplace_back(Shape{
+          .indices = local.indices,
+          .vertices = {},
+          .materialId = submeshes[i].materialId,
+          .submeshIndex = i,
+      });
+      shape.vertices.reserve(local.vertices.size() * floatsPerVertex);
+      for (const uint32_t vertexIndex : local.vertices) {
+        shape.vertices.insert(
+            shape.vertices.cend(),
+            vertices.cbegin() + static_cast<ptrdiff_t>(vertexIndex * floatsPerVertex),
+            vertices.cbegin() + static_cast<ptrdiff_t>((vertexIndex + 1) * floatsPerVertex));
+      }
+    }
+    result.instances[i].shapeIndex = shapeIndices[firstSubmeshes[i]];
+  }
+  return std::move(result);
+}
+
+InstancedClusterHierarchies buildInstancedClusterHierarchies(
+    const std::vector<uint32_t>& indices,
+    const std::vector<Submesh>& submeshes,
+    const std::vector<float>& vertices,
+    const size_t vertexStride,
+    const Params& params,
+    const DeduplicationParams& deduplicationParams) {
+  InstancedClusterHierarchies result{
+      .hierarchies = {},
+      .submeshes = deduplicateSubmeshes(indices, submeshes, vertices, vertexStride, deduplicationParams),
+  };
+  result.hierarchies.reserve(result.submeshes.shapes.size());
+  for (const auto& shape : result.submeshes.shapes) {
+    if (shape.indices.empty()) {
+      result.hierarchies.emplace_back();
+      continue;
+    }
+    result.hierarchies.emplace_back(buildClusterHierarchy(
+        shape.indices,
+        {Submesh{.firstIndex = 0, .indexCount = shape.indices.size(), .materialId = shape.materialId}},
+        shape.vertices,
+        vertexStride,
+        params));
+  }
+  return std::move(result);
+}
+}  // namespace trichi
@@ -0,0 +1,779 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "loaders.hpp"
+
+/**
+ * Splits `count` items into one contiguous range per thread and calls `body(begin, end, range)` for each range in parallel.
+ * Exceptions thrown by `body` are rethrown after all threads have finished.
+ */
+template <typename Body>
+void parallelFor(const size_t threadCount, const size_t count, Body&& body) {
+  const size_t numRanges = std::max(std::min(threadCount, count), static_cast<size_t>(1));
+  std::vector<std::exception_ptr> errors(numRanges);
+  const auto runRange = [&](const size_t range) {
+    try {
+      body(count * range / numRanges, count * (range + 1) / numRanges, range);
+    } catch (...) {
+      errors[range] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads{};
+  threads.reserve(numRanges - 1);
+  for (size_t range = 1; range < numRanges; ++range) {
+    threads.emplace_back(runRange, range);
+  }
+  runRange(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+/**
+ * Reads a whole file into memory in fixed-size chunks, bypassing the stream's buffer.
+ * The parsers split the data into one range per thread, so parsing starts once the whole file has been read.
+ */
+[[nodiscard]] std::vector<char> readFile(const std::filesystem::path& path) {
+  constexpr size_t kChunkSize = size_t{16} << 20;
+  std::ifstream stream{};
+  stream.rdbuf()->pubsetbuf(nullptr, 0);
+  stream.open(path, std::ios::binary | std::ios::ate);
+  if (!stream) {
+    throw std::runtime_error("could not open " + path.string());
+  }
+  std::vector<char> data(static_cast<size_t>(stream.tellg()));
+  stream.seekg(0);
+  for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+    if (!stream.read(data.data() + offset, static_cast<std::streamsize>(std::min(kChunkSize, data.size() - offset)))) {
+      throw std::runtime_error("could not read " + path.string());
+    }
+  }
+  return data;
+}
+
+/**
+ * Computes smooth vertex normals weighted by the area of the triangles using a vertex.
+ * The vertices are expected to store a position followed by a normal.
+ */
+void computeSmoothNormals(std::vector<float>& vertices, const std::vector<uint32_t>& indices, const size_t threadCount) {
+  constexpr size_t floatsPerVertex = 6;
+  const size_t numVertices = vertices.size() / floatsPerVertex;
+  const size_t numTriangles = indices.size() / 3;
+
+  // the cross product's length is twice the triangle's area
+  std::vector<float> triangleNormals(numTriangles * 3);
+  parallelFor(threadCount, numTriangles, [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      const float* a = &vertices[indices[i * 3] * floatsPerVertex];
+      const float* b = &vertices[indices[i * 3 + 1] * floatsPerVertex];
+      const float* c = &vertices[indices[i * 3 + 2] * floatsPerVertex];
+      const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+      triangleNormals[i * 3] = ab[1] * ac[2] - ab[2] * ac[1];
+      triangleNormals[i * 3 + 1] = ab[2] * ac[0] - ab[0] * ac[2];
+      triangleNormals[i * 3 + 2] = ab[0] * ac[1] - ab[1] * ac[0];
+    }
+  });
+
+  // the triangles using each vertex (CSR), so that each vertex's normal is summed by a single thread
+  std::vector<std::atomic_uint32_t> cursors(numVertices + 1);
+  parallelFor(threadCount, indices.size(), [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      cursors[indices[i] + 1].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  std::vector<uint32_t> offsets(numVertices + 1, 0);
+  for (size_t i = 0; i < numVertices; ++i) {
+    offsets[i + 1] = offsets[i] + cursors[i + 1].load(std::memory_order_relaxed);
+    cursors[i].store(offsets[i], std::memory_order_relaxed);
+  }
+  std::vector<uint32_t> vertexTriangles(indices.size());
+  parallelFor(threadCount, indices.size(), [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      vertexTriangles[cursors[indices[i]].fetch_add(1, std::memory_order_relaxed)] = static_cast<uint32_t>(i / 3);
+    }
+  });
+
+  // triangles are summed in order, so that the normals don't depend on the number of threads
+  parallelFor(threadCount, numVertices, [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto first = vertexTriangles.begin() + offsets[i];
+      const auto last = vertexTriangles.begin() + offsets[i + 1];
+      std::sort(first, last);
+      float normal[3] = {0.0f, 0.0f, 0.0f};
+      for (auto triangle = first; triangle != last; ++triangle) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+          normal[axis] += triangleNormals[*triangle * 3 + axis];
+        }
+      }
+      const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+      const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+      for (size_t axis = 0; axis < 3; ++axis) {
+        vertices[i * floatsPerVertex + 3 + axis] = normal[axis] * scale;
+      }
+    }
+  });
+}
+
+enum class PlyType {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64,
+};
+
+[[nodiscard]] std::optional<PlyType> parsePlyType(const std::string& name) {
+  if (name == "char" || name == "int8") return PlyType::Int8;
+  if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+  if (name == "short" || name == "int16") return PlyType::Int16;
+  if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+  if (name == "int" || name == "int32") return PlyType::Int32;
+  if (name == "uint" || name == "uint32") return PlyType::UInt32;
+  if (name == "float" || name == "float32") return PlyType::Float32;
+  if (name == "double" || name == "float64") return PlyType::Float64;
+  return std::nullopt;
+}
+
+[[nodiscard]] size_t plyTypeSize(const PlyType type) {
+  switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+      return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+      return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+      return 4;
+    case PlyType::Float64:
+    default:
+      return 8;
+  }
+}
+
+template <typename T>
+[[nodiscard]] T loadPlyValue(const char* data, const bool swapBytes) {
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, data, sizeof(T));
+  if (swapBytes) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+[[nodiscard]] double readPlyValue(const char* data, const PlyType type, const bool swapBytes) {
+  switch (type) {
+    case PlyType::Int8:
+      return loadPlyValue<int8_t>(data, swapBytes);
+    case PlyType::UInt8:
+      return loadPlyValue<uint8_t>(data, swapBytes);
+    case PlyType::Int16:
+      return loadPlyValue<int16_t>(data, swapBytes);
+    case PlyType::UInt16:
+      return loadPlyValue<uint16_t>(data, swapBytes);
+    case PlyType::Int32:
+      return loadPlyValue<int32_t>(data, swapBytes);
+    case PlyType::UInt32:
+      return loadPlyValue<uint32_t>(data, swapBytes);
+    case PlyType::Float32:
+      return loadPlyValue<float>(data, swapBytes);
+    case PlyType::Float64:
+    default:
+      return loadPlyValue<double>(data, swapBytes);
+  }
+}
+
+struct PlyProperty {
+  std::string name{};
+  PlyType type = PlyType::Float32;
+  bool isList = false;
+  PlyType countType = PlyType::UInt8;
+};
+
+struct PlyElement {
+  std::string name{};
+  size_t count = 0;
+  std::vector<PlyProperty> properties{};
+
+  /**
+   * The size of each record, or 0 if the element has list properties.
+   */
+  [[nodiscard]] size_t recordSize() const {
+    size_t size = 0;
+    for (const auto& property : properties) {
+      if (property.isList) {
+        return 0;
+      }
+      size += plyTypeSize(property.type);
+    }
+    return size;
+  }
+
+  [[nodiscard]] std::optional<size_t> findProperty(const std::initializer_list<std::string_view> names) const {
+    for (size_t i = 0; i < properties.size(); ++i) {
+      if (std::find(names.begin(), names.end(), properties[i].name) != names.end()) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * Reads a PLY file's vertex positions & normals.
+ * Properties other than the position & normal are skipped.
+ */
+void readPlyVertices(const PlyElement& element, const char* data, const bool swapBytes, const size_t threadCount, LoadedMesh& mesh, bool& hasNormals) {
+  const size_t recordSize = element.recordSize();
+  std::vector<size_t> offsets(element.properties.size(), 0);
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    offsets[i] = offsets[i - 1] + plyTypeSize(element.properties[i - 1].type);
+  }
+  const auto x = element.findProperty({"x"});
+  const auto y = element.findProperty({"y"});
+  const auto z = element.findProperty({"z"});
+  if (!x || !y || !z) {
+    throw std::runtime_error("PLY vertices have no position");
+  }
+  const auto nx = element.findProperty({"nx"});
+  const auto ny = element.findProperty({"ny"});
+  const auto nz = element.findProperty({"nz"});
+  hasNormals = nx && ny && nz;
+  const size_t attributes[6] = {*x, *y, *z, hasNormals ? *nx : 0, hasNormals ? *ny : 0, hasNormals ? *nz : 0};
+  const size_t numAttributes = hasNormals ? 6 : 3;
+
+  mesh.vertices.resize(element.count * 6, 0.0f);
+  parallelFor(threadCount, element.count, [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      const char* record = data + i * recordSize;
+      for (size_t attribute = 0; attribute < numAttributes; ++attribute) {
+        const auto& property = element.properties[attributes[attribute]];
+        mesh.vertices[i * 6 + attribute] = static_cast<float>(readPlyValue(record + offsets[attributes[attribute]], property.type, swapBytes));
+      }
+    }
+  });
+}
+
+/**
+ * Reads a PLY file's faces, triangulating polygons as fans.
+ * If every face is a triangle and has no other properties, all records have the same size and are read in parallel.
+ *
+ * @return Returns the end of the face element's data.
+ */
+const char* readPlyFaces(const PlyElement& element, const char* data, const char* dataEnd, const bool swapBytes, const size_t threadCount, LoadedMesh& mesh) {
+  const auto indexProperty = element.findProperty({"vertex_indices", "vertex_index"});
+  if (!indexProperty || !element.properties[*indexProperty].isList) {
+    throw std::runtime_error("PLY faces have no vertex indices");
+  }
+  const auto& indexList = element.properties[*indexProperty];
+  const size_t countSize = plyTypeSize(indexList.countType);
+  const size_t indexSize = plyTypeSize(indexList.type);
+  const size_t numVertices = mesh.vertices.size() / 6;
+
+  const size_t triangleRecordSize = countSize + 3 * indexSize;
+  if (element.properties.size() == 1 && static_cast<size_t>(dataEnd - data) >= element.count * triangleRecordSize) {
+    mesh.indices.resize(element.count * 3);
+    std::vector<uint8_t> isTriangleMesh(std::max(threadCount, static_cast<size_t>(1)), 1);
+    parallelFor(threadCount, element.count, [&](const size_t begin, const size_t end, const size_t range) {
+      for (size_t i = begin; i < end; ++i) {
+        const char* record = data + i * triangleRecordSize;
+        if (readPlyValue(record, indexList.countType, swapBytes) != 3.0) {
+          isTriangleMesh[range] = 0;
+          return;
+        }
+        for (size_t j = 0; j < 3; ++j) {
+          // records after a polygon are misaligned, so invalid indices are reported by reading the faces one after another
+          const double index = readPlyValue(record + countSize + j * indexSize, indexList.type, swapBytes);
+          if (index < 0.0 || index >= static_cast<double>(numVertices)) {
+            isTriangleMesh[range] = 0;
+            return;
+          }
+          mesh.indices[i * 3 + j] = static_cast<uint32_t>(index);
+        }
+      }
+    });
+    if (std::all_of(isTriangleMesh.cbegin(), isTriangleMesh.cend(), [](const uint8_t isTriangle) { return isTriangle != 0; })) {
+      return data + element.count * triangleRecordSize;
+    }
+    mesh.indices.clear();
+  }
+
+  // faces have different sizes, so they can only be read one after another
+  mesh.indices.reserve(element.count * 3);
+  std::vector<uint32_t> polygon{};
+  const char* record = data;
+  for (size_t i = 0; i < element.count; ++i) {
+    for (size_t p = 0; p < element.properties.size(); ++p) {
+      const auto& property = element.properties[p];
+      if (!property.isList) {
+        record += plyTypeSize(property.type);
+        if (record > dataEnd) {
+          throw std::runtime_error("unexpected end of PLY file");
+        }
+        continue;
+      }
+      if (record + plyTypeSize(property.countType) > dataEnd) {
+        throw std::runtime_error("unexpected end of PLY file");
+      }
+      const auto count = static_cast<size_t>(readPlyValue(record, property.countType, swapBytes));
+      record += plyTypeSize(property.countType);
+      if (record + count * plyTypeSize(property.type) > dataEnd) {
+        throw std::runtime_error("unexpected end of PLY file");
+      }
+      if (p == *indexProperty) {
+        polygon.resize(count);
+        for (size_t j = 0; j < count; ++j) {
+          const double index = readPlyValue(record + j * indexSize, property.type, swapBytes);
+          if (index < 0.0 || index >= static_cast<double>(numVertices)) {
+            throw std::runtime_error("PLY face index out of range");
+          }
+          polygon[j] = static_cast<uint32_t>(index);
+        }
+        for (size_t j = 2; j < count; ++j) {
+          mesh.indices.insert(mesh.indices.cend(), {polygon[0], polygon[j - 1], polygon[j]});
+        }
+      }
+      record += count * plyTypeSize(property.type);
+    }
+  }
+  return record;
+}
+
+[[nodiscard]] std::optional<LoadedMesh> loadPly(const std::filesystem::path& path, const size_t threadCount) {
+  const auto file = readFile(path);
+  const std::string_view text(file.data(), file.size());
+  const auto headerEnd = text.find("end_header");
+  if (text.substr(0, 3) != "ply" || headerEnd == std::string_view::npos) {
+    throw std::runtime_error("invalid PLY header in " + path.string());
+  }
+  const size_t dataOffset = text.find('\n', headerEnd);
+  if (dataOffset == std::string_view::npos) {
+    throw std::runtime_error("invalid PLY header in " + path.string());
+  }
+
+  std::istringstream header(std::string(text.substr(0, headerEnd)));
+  std::vector<PlyElement> elements{};
+  bool swapBytes = false;
+  std::string line{};
+  while (std::getline(header, line)) {
+    std::istringstream tokens(line);
+    std::string keyword{};
+    tokens >> keyword;
+    if (keyword == "format") {
+      std::string format{};
+      tokens >> format;
+      if (format == "binary_little_endian") {
+        swapBytes = std::endian::native != std::endian::little;
+      } else if (format == "binary_big_endian") {
+        swapBytes = std::endian::native != std::endian::big;
+      } else {
+        return std::nullopt;
+      }
+    } else if (keyword == "element") {
+      auto& element = elements.emplace_back();
+      tokens >> element.name >> element.count;
+    } else if (keyword == "property") {
+      if (elements.empty()) {
+        throw std::runtime_error("invalid PLY header in " + path.string());
+      }
+      PlyProperty property{};
+      std::string type{};
+      tokens >> type;
+      if (type == "list") {
+        std::string countType{};
+        tokens >> countType >> type;
+        const auto parsedCountType = parsePlyType(countType);
+        if (!parsedCountType) {
+          return std::nullopt;
+        }
+        property.isList = true;
+        property.countType = *parsedCountType;
+      }
+      const auto parsedType = parsePlyType(type);
+      if (!parsedType) {
+        return std::nullopt;
+      }
+      property.type = *parsedType;
+      tokens >> property.name;
+      elements.back().properties.emplace_back(property);
+    }
+  }
+
+  LoadedMesh mesh{};
+  mesh.fileSizeBytes = file.size();
+  bool hasVertices = false;
+  bool hasNormals = false;
+  const char* data = file.data() + dataOffset + 1;
+  const char* dataEnd = file.data() + file.size();
+  for (const auto& element : elements) {
+    if (hasVertices && !mesh.indices.empty()) {
+      break;
+    }
+    if (element.name == "vertex") {
+      const size_t recordSize = element.recordSize();
+      if (recordSize == 0) {
+        return std::nullopt;
+      }
+      if (static_cast<size_t>(dataEnd - data) < element.count * recordSize) {
+        throw std::runtime_error("unexpected end of PLY file " + path.string());
+      }
+      readPlyVertices(element, data, swapBytes, threadCount, mesh, hasNormals);
+      hasVertices = true;
+      data += element.count * recordSize;
+    } else if (element.name == "face") {
+      // faces refer to vertices, so they are only read after them
+      if (!hasVertices) {
+        return std::nullopt;
+      }
+      data = readPlyFaces(element, data, dataEnd, swapBytes, threadCount, mesh);
+    } else {
+      // other elements are skipped, which is only possible if their records have a fixed size
+      const size_t recordSize = element.recordSize();
+      if (recordSize == 0) {
+        return std::nullopt;
+      }
+      data += element.count * recordSize;
+    }
+    if (data > dataEnd) {
+      throw std::runtime_error("unexpected end of PLY file " + path.string());
+    }
+  }
+
+  if (!hasNormals) {
+    computeSmoothNormals(mesh.vertices, mesh.indices, threadCount);
+  }
+  mesh.submeshes.emplace_back(trichi::Submesh{.firstIndex = 0, .indexCount = mesh.indices.size()});
+  return mesh;
+}
+
+/**
+ * A corner of an OBJ face, referencing a position and, optionally, a normal.
+ * Relative (negative) indices are resolved within the chunk they were parsed in and stored with `kObjRelativeIndex` added,
+ * so that they can be offset by the number of positions or normals in all previous chunks afterward.
+ */
+struct ObjCorner {
+  int64_t position = 0;
+  int64_t normal = -1;
+};
+
+constexpr int64_t kObjRelativeIndex = int64_t{1} << 62;
+
+/**
+ * The contents of a range of lines of an OBJ file.
+ */
+struct ObjChunk {
+  std::vector<float> positions{};
+  std::vector<float> normals{};
+
+  /**
+   * The corners of all triangles in the chunk.
+   */
+  std::vector<ObjCorner> corners{};
+
+  /**
+   * The `usemtl` statements in the chunk and the first triangle they apply to.
+   */
+  std::vector<std::pair<size_t, std::string>> materials{};
+
+  size_t positionOffset = 0;
+  size_t normalOffset = 0;
+  size_t triangleOffset = 0;
+};
+
+[[nodiscard]] const char* skipObjSpaces(const char* it, const char* end) {
+  while (it < end && (*it == ' ' || *it == '\t')) {
+    ++it;
+  }
+  return it;
+}
+
+[[nodiscard]] const char* parseObjFloat(const char* it, const char* end, float& value) {
+  it = skipObjSpaces(it, end);
+  if (it < end && *it == '+') {
+    ++it;
+  }
+  const auto [next, error] = std::from_chars(it, end, value);
+  if (error != std::errc{}) {
+    throw std::runtime_error("invalid number in OBJ file");
+  }
+  return next;
+}
+
+/**
+ * Parses an OBJ index and resolves it to a 0-based index, see `ObjCorner`.
+ */
+[[nodiscard]] const char* parseObjIndex(const char* it, const char* end, const size_t localCount, int64_t& index) {
+  int64_t value = 0;
+  const auto [next, error] = std::from_chars(it, end, value);
+  if (error != std::errc{} || value == 0) {
+    throw std::runtime_error("invalid index in OBJ file");
+  }
+  index = value > 0 ? value - 1 : kObjRelativeIndex + static_cast<int64_t>(localCount) + value;
+  return next;
+}
+
+void parseObjChunk(const char* it, const char* end, ObjChunk& chunk) {
+  std::vector<ObjCorner> polygon{};
+  while (it < end) {
+    const char* lineEnd = static_cast<const char*>(std::memchr(it, '\n', static_cast<size_t>(end - it)));
+    lineEnd = lineEnd != nullptr ? lineEnd : end;
+    it = skipObjSpaces(it, lineEnd);
+    const std::string_view line(it, static_cast<size_t>(lineEnd - it));
+    if (line.starts_with("v ") || line.starts_with("v\t")) {
+      float position[3];
+      const char* next = it + 1;
+      for (float& value : position) {
+        next = parseObjFloat(next, lineEnd, value);
+      }
+      chunk.positions.insert(chunk.positions.cend(), position, position + 3);
+    } else if (line.starts_with("vn ") || line.starts_with("vn\t")) {
+      float normal[3];
+      const char* next = it + 2;
+      for (float& value : normal) {
+        next = parseObjFloat(next, lineEnd, value);
+      }
+      chunk.normals.insert(chunk.normals.cend(), normal, normal + 3);
+    } else if (line.starts_with("f ") || line.starts_with("f\t")) {
+      polygon.clear();
+      const char* next = skipObjSpaces(it + 1, lineEnd);
+      while (next < lineEnd && *next != '\r' && *next != '#') {
+        ObjCorner corner{};
+        next = parseObjIndex(next, lineEnd, chunk.positions.size() / 3, corner.position);
+        // texture coordinates are skipped
+        if (next < lineEnd && *next == '/') {
+          ++next;
+          while (next < lineEnd && *next != '/' && *next != ' ' && *next != '\t' && *next != '\r') {
+            ++next;
+          }
+          if (next < lineEnd && *next == '/') {
+            next = parseObjIndex(next + 1, lineEnd, chunk.normals.size() / 3, corner.normal);
+          }
+        }
+        polygon.emplace_back(corner);
+        next = skipObjSpaces(next, lineEnd);
+      }
+      for (size_t j = 2; j < polygon.size(); ++j) {
+        chunk.corners.insert(chunk.corners.cend(), {polygon[0], polygon[j - 1], polygon[j]});
+      }
+    } else if (line.starts_with("usemtl")) {
+      auto name = line.substr(6);
+      while (!name.empty() && (name.back() == '\r' || name.back() == ' ' || name.back() == '\t')) {
+        name.remove_suffix(1);
+      }
+      while (!name.empty() && (name.front() == ' ' || name.front() == '\t')) {
+        name.remove_prefix(1);
+      }
+      chunk.materials.emplace_back(chunk.corners.size() / 3, std::string(name));
+    }
+    it = lineEnd < end ? lineEnd + 1 : end;
+  }
+}
+
+/**
+ * Resolves an index parsed by `parseObjIndex` to an index into the whole file's positions or normals.
+ */
+[[nodiscard]] uint32_t resolveObjIndex(const int64_t index, const size_t chunkOffset, const size_t count) {
+  const int64_t resolved = index >= kObjRelativeIndex / 2 ? static_cast<int64_t>(chunkOffset) + (index - kObjRelativeIndex) : index;
+  if (resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+    throw std::runtime_error("OBJ face index out of range");
+  }
+  return static_cast<uint32_t>(resolved);
+}
+
+[[nodiscard]] LoadedMesh loadObj(const std::filesystem::path& path, const size_t threadCount) {
+  const auto file = readFile(path);
+
+  // the file is split into one chunk of whole lines per thread
+  const size_t numChunks = std::max(std::min(threadCount, file.size() / (1 << 16)), static_cast<size_t>(1));
+  std::vector<const char*> chunkStarts(numChunks + 1, file.data() + file.size());
+  chunkStarts[0] = file.data();
+  for (size_t i = 1; i < numChunks; ++i) {
+    const char* start = std::max(file.data() + file.size() * i / numChunks, chunkStarts[i - 1]);
+    const char* end = file.data() + file.size();
+    const char* lineEnd = static_cast<const char*>(std::memchr(start, '\n', static_cast<size_t>(end - start)));
+    chunkStarts[i] = lineEnd != nullptr ? lineEnd + 1 : end;
+  }
+  std::vector<ObjChunk> chunks(numChunks);
+  parallelFor(threadCount, numChunks, [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      parseObjChunk(chunkStarts[i], chunkStarts[i + 1], chunks[i]);
+    }
+  });
+
+  size_t numPositions = 0;
+  size_t numNormals = 0;
+  size_t numTriangles = 0;
+  for (auto& chunk : chunks) {
+    chunk.positionOffset = numPositions;
+    chunk.normalOffset = numNormals;
+    chunk.triangleOffset = numTriangles;
+    numPositions += chunk.positions.size() / 3;
+    numNormals += chunk.normals.size() / 3;
+    numTriangles += chunk.corners.size() / 3;
+  }
+
+  // corners are resolved to positions & normals, and vertices are shared by all corners with the same position & normal
+  std::vector<uint32_t> cornerPositions(numTriangles * 3);
+  std::vector<uint32_t> cornerNormals(numTriangles * 3);
+  std::vector<uint8_t> hasNormals(numChunks, 1);
+  std::vector<uint8_t> isPositionNormal(numChunks, 1);
+  parallelFor(threadCount, numChunks, [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto& chunk = chunks[i];
+      for (size_t j = 0; j < chunk.corners.size(); ++j) {
+        const auto& corner = chunk.corners[j];
+        const size_t cornerIndex = chunk.triangleOffset * 3 + j;
+        cornerPositions[cornerIndex] = resolveObjIndex(corner.position, chunk.positionOffset, numPositions);
+        if (corner.normal < 0) {
+          hasNormals[i] = 0;
+          continue;
+        }
+        cornerNormals[cornerIndex] = resolveObjIndex(corner.normal, chunk.normalOffset, numNormals);
+        isPositionNormal[i] = isPositionNormal[i] && cornerNormals[cornerIndex] == cornerPositions[cornerIndex];
+      }
+    }
+  });
+  const bool useNormals = std::all_of(hasNormals.cbegin(), hasNormals.cend(), [](const uint8_t has) { return has != 0; });
+  const bool isIndexedByPosition = !useNormals || (numNormals == numPositions && std::all_of(isPositionNormal.cbegin(), isPositionNormal.cend(), [](const uint8_t is) { return is != 0; }));
+
+  LoadedMesh mesh{};
+  mesh.fileSizeBytes = file.size();
+  std::vector<uint32_t> cornerVertices{};
+  std::vector<std::pair<uint32_t, uint32_t>> vertexSources{};
+  if (isIndexedByPosition) {
+    cornerVertices = std::move(cornerPositions);
+    vertexSources.resize(numPositions);
+    for (uint32_t i = 0; i < numPositions; ++i) {
+      vertexSources[i] = {i, i};
+    }
+  } else {
+    std::unordered_map<uint64_t, uint32_t> vertexIndices{};
+    vertexIndices.reserve(numPositions);
+    cornerVertices.resize(cornerPositions.size());
+    for (size_t i = 0; i < cornerPositions.size(); ++i) {
+      const uint64_t key = (static_cast<uint64_t>(cornerPositions[i]) << 32) | cornerNormals[i];
+      const auto [it, inserted] = vertexIndices.try_emplace(key, static_cast<uint32_t>(vertexSources.size()));
+      if (inserted) {
+        vertexSources.emplace_back(cornerPositions[i], cornerNormals[i]);
+      }
+      cornerVertices[i] = it->second;
+    }
+  }
+
+  mesh.vertices.resize(vertexSources.size() * 6, 0.0f);
+  const auto findChunk = [&chunks](const size_t index, size_t ObjChunk::*offset) {
+    return std::upper_bound(chunks.cbegin(), chunks.cend(), index, [offset](const size_t i, const ObjChunk& chunk) {
+      return i < chunk.*offset;
+    }) - 1;
+  };
+  parallelFor(threadCount, vertexSources.size(), [&](const size_t begin, const size_t end, const size_t) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto [position, normal] = vertexSources[i];
+      const auto positionChunk = findChunk(position, &ObjChunk::positionOffset);
+      std::copy_n(&positionChunk->positions[(position - positionChunk->positionOffset) * 3], 3, &mesh.vertices[i * 6]);
+      if (useNormals) {
+        const auto normalChunk = findChunk(normal, &ObjChunk::normalOffset);
+        std::copy_n(&normalChunk->normals[(normal - normalChunk->normalOffset) * 3], 3, &mesh.vertices[i * 6 + 3]);
+      }
+    }
+  });
+
+  // triangles are sorted by material, which are numbered by their first use
+  std::unordered_map<std::string, uint32_t> materialIds{};
+  std::vector<std::pair<size_t, uint32_t>> materialRuns{{0, 0}};
+  materialIds.emplace("", 0);
+  for (const auto& chunk : chunks) {
+    for (const auto& [triangle, name] : chunk.materials) {
+      const auto [it, inserted] = materialIds.try_emplace(name, static_cast<uint32_t>(materialIds.size()));
+      materialRuns.emplace_back(chunk.triangleOffset + triangle, it->second);
+    }
+  }
+  std::vector<size_t> materialTriangles(materialIds.size(), 0);
+  for (size_t run = 0; run < materialRuns.size(); ++run) {
+    const size_t runEnd = run + 1 < materialRuns.size() ? materialRuns[run + 1].first : numTriangles;
+    materialTriangles[materialRuns[run].second] += runEnd - materialRuns[run].first;
+  }
+  if (materialTriangles[0] == 0 && materialTriangles.size() > 1) {
+    // all faces have a named material, so named materials are numbered from 0
+    for (auto& [triangle, id] : materialRuns) {
+      id = id == 0 ? 0 : id - 1;
+    }
+    materialTriangles.erase(materialTriangles.begin());
+  }
+
+  std::vector<size_t> materialOffsets(materialTriangles.size(), 0);
+  size_t firstIndex = 0;
+  for (size_t material = 0; material < materialTriangles.size(); ++material) {
+    materialOffsets[material] = firstIndex;
+    if (materialTriangles[material] != 0) {
+      mesh.submeshes.emplace_back(trichi::Submesh{
+          .firstIndex = firstIndex,
+          .indexCount = materialTriangles[material] * 3,
+          .materialId = static_cast<uint32_t>(material),
+      });
+    }
+    firstIndex += materialTriangles[material] * 3;
+  }
+  if (mesh.submeshes.size() <= 1) {
+    mesh.indices = std::move(cornerVertices);
+  } else {
+    mesh.indices.resize(cornerVertices.size());
+    for (size_t run = 0; run < materialRuns.size(); ++run) {
+      const size_t runEnd = run + 1 < materialRuns.size() ? materialRuns[run + 1].first : numTriangles;
+      const size_t runIndices = (runEnd - materialRuns[run].first) * 3;
+      std::copy_n(cornerVertices.cbegin() + static_cast<ptrdiff_t>(materialRuns[run].first * 3), runIndices, mesh.indices.begin() + static_cast<ptrdiff_t>(materialOffsets[materialRuns[run].second]));
+      materialOffsets[materialRuns[run].second] += runIndices;
+    }
+  }
+  if (mesh.submeshes.empty()) {
+    mesh.submeshes.emplace_back(trichi::Submesh{});
+  }
+
+  if (!useNormals) {
+    computeSmoothNormals(mesh.vertices, mesh.indices, threadCount);
+  }
+  return mesh;
+}
+
+std::optional<LoadedMesh> loadMeshNative(const std::filesystem::path& path, const size_t threadCount) {
+  auto extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  if (extension == ".ply") {
+    return loadPly(path, threadCount);
+  }
+  if (extension == ".obj") {
+    return loadObj(path, threadCount);
+  }
+  return std::nullopt;
+}
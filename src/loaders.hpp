@@ -0,0 +1,51 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#ifndef TRICHI_LOADERS_HPP
+#define TRICHI_LOADERS_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "trichi.hpp"
+
+/**
+ * A mesh loaded for the CLI, with one submesh per material.
+ */
+struct LoadedMesh {
+  /**
+   * The mesh's vertices - each vertex stores a position followed by a normal.
+   */
+  std::vector<float> vertices{};
+
+  std::vector<uint32_t> indices{};
+
+  std::vector<trichi::Submesh> submeshes{};
+
+  /**
+   * The number of bytes read from the mesh's file.
+   */
+  size_t fileSizeBytes = 0;
+};
+
+/**
+ * Loads a binary PLY or an OBJ file without going through Assimp.
+ *
+ * The file is read with a single large read and parsed by multiple threads straight into the mesh's preallocated arrays.
+ * Polygons are triangulated as fans.
+ * Meshes without normals get smooth normals, weighted by triangle area, without splitting vertices at creases.
+ *
+ * An OBJ file's materials are numbered in the order of their first `usemtl` statement.
+ * If there are faces before the first `usemtl` statement, they use material 0 and named materials start at 1.
+ *
+ * @param path the mesh's file - only files ending in .ply or .obj are loaded
+ * @param threadCount the number of threads used for parsing the file
+ * @return Returns the loaded mesh, or nothing if the file's format is not supported, e.g., ASCII PLY files, so that it can be loaded with Assimp instead.
+ */
+[[nodiscard]] std::optional<LoadedMesh> loadMeshNative(const std::filesystem::path& path, size_t threadCount);
+
+#endif  //TRICHI_LOADERS_HPP
@@ -3,9 +3,12 @@
 * SPDX-License-Identifier: MIT
 */
 
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <numbers>
 #include <string>
 #include <thread>
 
@@ -16,6 +19,208 @@
 
 #include "trichi.hpp"
 
+#include "bake.hpp"
+#include "loaders.hpp"
+
+/**
+ * Loads a recorded camera path with one camera position per line.
+ */
+std::vector<trichi::ViewParams> loadCameraPath(const std::string& path, const float projectionScale, const float errorThreshold) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw std::runtime_error("could not open camera path " + path);
+  }
+  std::vector<trichi::ViewParams> cameraPath{};
+  trichi::ViewParams view{};
+  view.projectionScale = projectionScale;
+  view.errorThreshold = errorThreshold;
+  while (stream >> view.cameraPosition[0] >> view.cameraPosition[1] >> view.cameraPosition[2]) {
+    cameraPath.push_back(view);
+  }
+  return cameraPath;
+}
+
+/**
+ * Creates a camera path orbiting a bounding box around its y axis while moving towards and away from it.
+ */
+std::vector<trichi::ViewParams> makeOrbitCameraPath(
+    const float* aabbMin,
+    const float* aabbMax,
+    const size_t numFrames,
+    const float projectionScale,
+    const float errorThreshold) {
+  const float center[3] = {
+      (aabbMin[0] + aabbMax[0]) * 0.5f, (aabbMin[1] + aabbMax[1]) * 0.5f, (aabbMin[2] + aabbMax[2]) * 0.5f};
+  const float radius = std::sqrt(
+      (aabbMax[0] - center[0]) * (aabbMax[0] - center[0]) +
+      (aabbMax[1] - center[1]) * (aabbMax[1] - center[1]) +
+      (aabbMax[2] - center[2]) * (aabbMax[2] - center[2]));
+  std::vector<trichi::ViewParams> cameraPath(numFrames);
+  for (size_t i = 0; i < numFrames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(std::max(numFrames, static_cast<size_t>(1)));
+    const float angle = 2.0f * std::numbers::pi_v<float> * t;
+    const float distance = radius * (1.5f + std::cos(2.0f * angle) * 0.8f);
+    auto& view = cameraPath[i];
+    view.cameraPosition[0] = center[0] + std::cos(angle) * distance;
+    view.cameraPosition[1] = center[1];
+    view.cameraPosition[2] = center[2] + std::sin(angle) * distance;
+    view.projectionScale = projectionScale;
+    view.errorThreshold = errorThreshold;
+  }
+  return cameraPath;
+}
+
+/**
+ * Loads a model with Assimp, merging all triangle meshes in the scene into one mesh with a submesh per mesh.
+ */
+LoadedMesh loadMeshAssimp(const std::string& path) {
+  Assimp::Importer importer;
+  importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0);
+  const struct aiScene* scene = importer.ReadFile(
+      path,
+      aiProcess_Triangulate |
+          aiProcess_GenSmoothNormals |
+          aiProcess_ImproveCacheLocality |
+          aiProcess_OptimizeGraph |
+          aiProcess_JoinIdenticalVertices |
+          aiProcess_SortByPType);
+  if (scene == nullptr) {
+    throw std::runtime_error("could not load " + path + ": " + importer.GetErrorString());
+  }
+
+  // the output arrays are allocated once, so that vertices & indices can be written in place
+  size_t numVertices = 0;
+  size_t numIndices = 0;
+  for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+    const aiMesh* mesh = scene->mMeshes[m];
+    if (mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) {
+      numVertices += mesh->mNumVertices;
+      numIndices += static_cast<size_t>(mesh->mNumFaces) * 3;
+    }
+  }
+  LoadedMesh loaded{};
+  loaded.fileSizeBytes = std::filesystem::file_size(path);
+  loaded.vertices.resize(numVertices * 6);
+  loaded.indices.resize(numIndices);
+
+  size_t baseVertex = 0;
+  size_t firstIndex = 0;
+  for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+    const aiMesh* mesh = scene->mMeshes[m];
+    if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) {
+      continue;
+    }
+    float* vertex = &loaded.vertices[baseVertex * 6];
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i, vertex += 6) {
+      vertex[0] = mesh->mVertices[i].x;
+      vertex[1] = mesh->mVertices[i].y;
+      vertex[2] = mesh->mVertices[i].z;
+      vertex[3] = mesh->mNormals[i].x;
+      vertex[4] = mesh->mNormals[i].y;
+      vertex[5] = mesh->mNormals[i].z;
+    }
+    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+      if (mesh->mFaces[i].mNumIndices != 3) {
+        throw std::runtime_error("encountered non-triangle face");
+      }
+      for (unsigned int j = 0; j < 3; ++j) {
+        loaded.indices[firstIndex + i * 3 + j] = static_cast<uint32_t>(baseVertex + mesh->mFaces[i].mIndices[j]);
+      }
+    }
+    loaded.submeshes.push_back(trichi::Submesh{
+        .firstIndex = firstIndex,
+        .indexCount = static_cast<size_t>(mesh->mNumFaces) * 3,
+        .materialId = mesh->mMaterialIndex,
+    });
+    baseVertex += mesh->mNumVertices;
+    firstIndex += static_cast<size_t>(mesh->mNumFaces) * 3;
+  }
+  return loaded;
+}
+
+/**
+ * Loads a model with the built-in loaders if they support its format, and with Assimp otherwise.
+ */
+LoadedMesh loadMesh(const std::filesystem::path& path, const bool forceAssimp, const size_t threadCount) {
+  auto mesh = forceAssimp ? std::nullopt : loadMeshNative(path, threadCount);
+  return mesh ? std::move(*mesh) : loadMeshAssimp(path.string());
+}
+
+/**
+ * Collects the files to bake and their outputs.
+ * Files in directories keep their path relative to the directory in the output directory.
+ */
+std::vector<BakeFile> collectBakeFiles(const std::vector<std::string>& inputs, const std::filesystem::path& outputDirectory) {
+  const Assimp::Importer importer;
+  const auto isModelFile = [&importer](const std::filesystem::path& path) {
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    return extension == ".ply" || extension == ".obj" || (!extension.empty() && importer.IsExtensionSupported(extension.c_str()));
+  };
+
+  std::vector<BakeFile> files{};
+  for (const auto& input : inputs) {
+    if (!std::filesystem::is_directory(input)) {
+      files.emplace_back(BakeFile{.input = input, .output = outputDirectory / (input + ".trichi")});
+      continue;
+    }
+    std::vector<std::filesystem::path> directoryFiles{};
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+      if (entry.is_regular_file() && isModelFile(entry.path())) {
+        directoryFiles.emplace_back(entry.path());
+      }
+    }
+    std::sort(directoryFiles.begin(), directoryFiles.end());
+    for (const auto& path : directoryFiles) {
+      auto output = outputDirectory / std::filesystem::relative(path, input);
+      output += ".trichi";
+      files.emplace_back(BakeFile{.input = path, .output = output});
+    }
+  }
+  return files;
+}
+
+/**
+ * Bakes all input files in a pipeline (see `bakeFiles`) and prints the bake's throughput.
+ */
+int bake(const argparse::ArgumentParser& program, const std::filesystem::path& outputDirectory) {
+  const auto files = collectBakeFiles(program.get<std::vector<std::string>>("--files"), outputDirectory);
+  const size_t bakeJobs = program.get<size_t>("--bake-jobs");
+
+  BakeOptions options{};
+  options.params.threadPoolSize = std::max(program.get<size_t>("--bake-build-threads"), static_cast<size_t>(1));
+  options.params.clusterConeWeight = 0.0;
+  options.params.seed = program.get<uint32_t>("--seed");
+  options.params.deferClusterOptimization = program.get<bool>("--defer-cluster-optimization");
+  options.loadThreads = program.get<size_t>("--bake-load-threads");
+  options.buildThreads = bakeJobs != 0 ? bakeJobs : std::max(std::thread::hardware_concurrency(), 1u);
+  options.queueCapacity = program.get<size_t>("--bake-queue-size");
+  options.cacheDirectory = program.get<std::string>("--cache-dir");
+  trichi::CacheStatistics cacheStatistics{};
+  options.cacheStatistics = &cacheStatistics;
+  options.reorderVertices = program.get<bool>("--reorder-vertices");
+
+  // files are loaded by several threads already, so each load is single-threaded
+  const bool forceAssimp = program.get<bool>("--assimp");
+  const auto statistics = bakeFiles(files, [forceAssimp](const std::filesystem::path& path) {
+    return loadMesh(path, forceAssimp, 1);
+  }, options);
+
+  const double seconds = std::max(statistics.seconds, 1e-6);
+  std::cout << "baked " << statistics.files - statistics.failedFiles << " of " << statistics.files << " files in " << statistics.seconds
+            << " s: " << static_cast<double>(statistics.files) / seconds << " files/s, "
+            << static_cast<double>(statistics.triangles) / seconds << " triangles/s, "
+            << static_cast<double>(statistics.bytesRead) / seconds / 1e6 << " MB/s read, "
+            << static_cast<double>(statistics.bytesWritten) / seconds / 1e6 << " MB/s written\n";
+  if (!options.cacheDirectory.empty()) {
+    std::cout << "cache: " << cacheStatistics.hits << " hits, " << cacheStatistics.misses << " misses, "
+              << cacheStatistics.bytesRead << " bytes read, " << cacheStatistics.bytesWritten << " bytes written, " << cacheStatistics.writeFailures << " write failures\n";
+  }
+  return statistics.failedFiles == 0 ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
   argparse::ArgumentParser program("dump_trichi_js");
   program.add_description("Creates clusters hierarchies and dump them as JS files.");
@@ -32,6 +237,113 @@ int main(int argc, char* argv[]) {
     .nargs(argparse::nargs_pattern::at_least_one)
     .default_value(std::vector<std::string>{});
 
+  program.add_argument("--assimp")
+    .help("load all files with Assimp instead of the built-in loaders for binary PLY & OBJ files")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--bake")
+    .help("bake all files to the binary bake format, overlapping loading, building & writing files - directories are searched for model files recursively")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--bake-jobs")
+    .help("the number of hierarchies built at the same time when baking (default: number of hardware threads)")
+    .default_value(static_cast<size_t>(0))
+    .scan<'u', size_t>();
+
+  program.add_argument("--bake-build-threads")
+    .help("the number of threads used by each build when baking")
+    .default_value(static_cast<size_t>(1))
+    .scan<'u', size_t>();
+
+  program.add_argument("--bake-load-threads")
+    .help("the number of files loaded at the same time when baking")
+    .default_value(static_cast<size_t>(2))
+    .scan<'u', size_t>();
+
+  program.add_argument("--bake-queue-size")
+    .help("the number of loaded meshes & baked files that may wait for the next stage when baking")
+    .default_value(static_cast<size_t>(8))
+    .scan<'u', size_t>();
+
+  program.add_argument("--seed")
+    .help("the seed used for grouping clusters")
+    .default_value(0u)
+    .scan<'u', uint32_t>();
+
+  program.add_argument("--defer-cluster-optimization")
+    .help("optimize all clusters in a single pass at the end of the build instead of per level")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--autotune")
+    .help("choose cluster & group sizes and the cluster cone weight for each file by building candidates on a sample of it")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--check-determinism")
+    .help("rebuild each hierarchy single-threaded and fail if the result differs from the multithreaded build")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--reorder-vertices")
+    .help("reorder each output's vertices by first use in cluster order for better vertex fetch locality")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--cache-dir")
+    .help("a directory for caching built hierarchies - files whose mesh & parameters are unchanged are not rebuilt")
+    .default_value(std::string{});
+
+  program.add_argument("--analyze")
+    .help("analyze each hierarchy's quality & cost and write the results to a JSON file in the output directory")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--min-fill-rate")
+    .help("fail if the mean fill rate of a hierarchy's clusters is below this (requires --analyze)")
+    .default_value(0.0f)
+    .scan<'g', float>();
+
+  program.add_argument("--simulate-streaming")
+    .help("simulate streaming each hierarchy along a camera path and write per-frame statistics to a CSV file in the output directory")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--camera-path")
+    .help("a file with one camera position (x y z) per line to simulate streaming along - if not given, the camera orbits the model")
+    .default_value(std::string{});
+
+  program.add_argument("--orbit-frames")
+    .help("the number of frames of the camera path orbiting the model")
+    .default_value(static_cast<size_t>(240))
+    .scan<'u', size_t>();
+
+  program.add_argument("--projection-scale")
+    .help("the scale of projected errors, e.g., 0.5 * viewportHeight / tan(0.5 * verticalFov) to measure errors in pixels")
+    .default_value(1000.0f)
+    .scan<'g', float>();
+
+  program.add_argument("--error-threshold")
+    .help("the maximum projected error of a selected cluster")
+    .default_value(1.0f)
+    .scan<'g', float>();
+
+  program.add_argument("--page-size")
+    .help("the size of a streaming page in bytes")
+    .default_value(static_cast<size_t>(128 * 1024))
+    .scan<'u', size_t>();
+
+  program.add_argument("--pool-size")
+    .help("the size of the streaming pool in bytes")
+    .default_value(static_cast<size_t>(64 * 1024 * 1024))
+    .scan<'u', size_t>();
+
+  program.add_argument("--eviction-policy")
+    .help("the policy for evicting pages from the streaming pool: lru, fifo, or finest")
+    .default_value(std::string{"lru"});
+
   try {
     program.parse_args(argc, argv);
   } catch (const std::exception& err) {
@@ -40,44 +352,73 @@ int main(int argc, char* argv[]) {
   }
 
   const std::filesystem::path output_dir = program.get<std::string>("-o");
+  const auto cacheDirectory = program.get<std::string>("--cache-dir");
+
+  if (program.get<bool>("--bake")) {
+    return bake(program, output_dir);
+  }
+
+  trichi::CacheStatistics cacheStatistics{};
   for (auto files = program.get<std::vector<std::string>>("--files"); const auto& f : files) {
     constexpr size_t vertexStride = 6 * sizeof(float);
-    std::vector<float> vertices{};
-    std::vector<uint32_t> indices{};
-    {
-      Assimp::Importer importer;
-      importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0);
-      const struct aiScene* scene = importer.ReadFile(
-          f,
-          aiProcess_Triangulate |
-              aiProcess_GenSmoothNormals |
-              aiProcess_ImproveCacheLocality |
-              aiProcess_OptimizeGraph |
-              aiProcess_JoinIdenticalVertices |
-              aiProcess_SortByPType);
-
-      for (int i = 0; i < scene->mMeshes[0]->mNumVertices; ++i) {
-        vertices.push_back(scene->mMeshes[0]->mVertices[i].x);
-        vertices.push_back(scene->mMeshes[0]->mVertices[i].y);
-        vertices.push_back(scene->mMeshes[0]->mVertices[i].z);
-        vertices.push_back(scene->mMeshes[0]->mNormals[i].x);
-        vertices.push_back(scene->mMeshes[0]->mNormals[i].y);
-        vertices.push_back(scene->mMeshes[0]->mNormals[i].z);
-      }
-      for (int i = 0; i < scene->mMeshes[0]->mNumFaces; ++i) {
-        if (scene->mMeshes[0]->mFaces[i].mNumIndices != 3) {
-          throw std::runtime_error("encountered non-triangle face");
-        }
-        for (int j = 0; j < scene->mMeshes[0]->mFaces[i].mNumIndices; ++j) {
-          indices.push_back(scene->mMeshes[0]->mFaces[i].mIndices[j]);
-        }
-      }
-    }
+    const auto loadStartTime = std::chrono::steady_clock::now();
+    auto nativeMesh = program.get<bool>("--assimp") ? std::nullopt : loadMeshNative(f, std::thread::hardware_concurrency());
+    const bool isNative = nativeMesh.has_value();
+    auto mesh = isNative ? std::move(*nativeMesh) : loadMeshAssimp(f);
+    const double loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStartTime).count();
+    std::cout << f << ": loaded " << mesh.vertices.size() / 6 << " vertices & " << mesh.indices.size() / 3 << " triangles with "
+              << (isNative ? "native loader" : "Assimp") << " in " << loadMilliseconds << " ms ("
+              << static_cast<double>(mesh.fileSizeBytes) / std::max(loadMilliseconds, 1e-3) / 1000.0 << " MB/s)\n";
+    auto& vertices = mesh.vertices;
+    const auto& indices = mesh.indices;
+    const auto& submeshes = mesh.submeshes;
 
     trichi::Params params{};
     params.threadPoolSize = std::thread::hardware_concurrency();
     params.clusterConeWeight = 0.0;
-    const auto dag = trichi::buildClusterHierarchy(indices, vertices, vertexStride, params);
+    params.seed = program.get<uint32_t>("--seed");
+    params.deferClusterOptimization = program.get<bool>("--defer-cluster-optimization");
+    if (program.get<bool>("--autotune")) {
+      params = trichi::autotuneParams(indices, vertices, vertexStride, params, trichi::AutotuneParams{
+          .threadPoolSize = params.threadPoolSize,
+      }).params;
+      std::cout << f << ": maxVerticesPerCluster " << params.maxVerticesPerCluster << ", maxTrianglesPerCluster "
+                << params.maxTrianglesPerCluster << ", targetClustersPerGroup " << params.targetClustersPerGroup
+                << ", clusterConeWeight " << params.clusterConeWeight << "\n";
+    }
+    auto dag = cacheDirectory.empty()
+        ? trichi::buildClusterHierarchy(indices, submeshes, vertices, vertexStride, params)
+        : trichi::buildClusterHierarchyCached(indices, submeshes, vertices, vertexStride, params, trichi::CacheParams{
+            .directory = cacheDirectory,
+            .statistics = &cacheStatistics,
+          });
+
+    if (program.get<bool>("--check-determinism")) {
+      trichi::Params sequentialParams = params;
+      sequentialParams.threadPoolSize = 1;
+      if (trichi::buildClusterHierarchy(indices, submeshes, vertices, vertexStride, sequentialParams) != dag) {
+        std::cerr << "non-deterministic hierarchy for " << f << "\n";
+        return 1;
+      }
+    }
+
+    if (program.get<bool>("--reorder-vertices")) {
+      (void)trichi::reorderVertices(dag, vertices, vertexStride, trichi::VertexReorderParams{
+          .threadPoolSize = params.threadPoolSize,
+      });
+    }
+
+    if (program.get<bool>("--analyze")) {
+      const auto analysis = trichi::analyzeClusterHierarchy(dag, trichi::AnalysisParams{
+          .maxTrianglesPerCluster = params.maxTrianglesPerCluster,
+          .threadPoolSize = params.threadPoolSize,
+      });
+      std::ofstream(output_dir / (f + ".analysis.json")) << trichi::toJson(analysis);
+      if (analysis.meanFillRate < program.get<float>("--min-fill-rate")) {
+        std::cerr << "mean cluster fill rate of " << f << " is " << analysis.meanFillRate << "\n";
+        return 1;
+      }
+    }
 
     float aabbMin[3] = {
         std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
@@ -133,6 +474,15 @@ int main(int argc, char* argv[]) {
     }
     js_stream << "]),\n";
 
+    js_stream << "  clusterMaterials: new Uint32Array([";
+    for (size_t i = 0; i < dag.materials.size(); ++i) {
+      js_stream << dag.materials[i];
+      if (i != dag.materials.size() - 1) {
+        js_stream << ",";
+      }
+    }
+    js_stream << "]),\n";
+
     js_stream << "  numMeshlets: " << dag.clusters.size() << ",\n";
 
     js_stream << "  maxClusterTriangles: " << params.maxTrianglesPerCluster << ",\n";
@@ -171,6 +521,49 @@ int main(int argc, char* argv[]) {
     js_stream << "]),\n";
 
     js_stream << "}" << std::endl;
+
+    if (program.get<bool>("--simulate-streaming")) {
+      const auto projectionScale = program.get<float>("--projection-scale");
+      const auto errorThreshold = program.get<float>("--error-threshold");
+      const auto cameraPathFile = program.get<std::string>("--camera-path");
+      const auto cameraPath = cameraPathFile.empty()
+          ? makeOrbitCameraPath(aabbMin, aabbMax, program.get<size_t>("--orbit-frames"), projectionScale, errorThreshold)
+          : loadCameraPath(cameraPathFile, projectionScale, errorThreshold);
+
+      trichi::StreamingParams streamingParams{};
+      streamingParams.pageSizeBytes = program.get<size_t>("--page-size");
+      streamingParams.poolSizeBytes = program.get<size_t>("--pool-size");
+      streamingParams.vertexSizeBytes = vertexStride;
+      const auto evictionPolicy = program.get<std::string>("--eviction-policy");
+      if (evictionPolicy == "fifo") {
+        streamingParams.evictionPolicy = trichi::EvictionPolicy::FirstInFirstOut;
+      } else if (evictionPolicy == "finest") {
+        streamingParams.evictionPolicy = trichi::EvictionPolicy::FinestLevelFirst;
+      } else if (evictionPolicy != "lru") {
+        std::cerr << "unknown eviction policy " << evictionPolicy << "\n";
+        return 1;
+      }
+
+      const auto report = trichi::simulateStreaming(dag, cameraPath, streamingParams);
+
+      std::ofstream csv_stream(output_dir / (f + ".streaming.csv"));
+      csv_stream << "frame,selectedClusters,missingClusters,requiredPages,workingSetBytes,pageFaults,pagesStreamed,bytesStreamed,pagesEvicted,residentBytes\n";
+      for (size_t i = 0; i < report.frames.size(); ++i) {
+        const auto& frame = report.frames[i];
+        csv_stream << i << "," << frame.selectedClusters << "," << frame.missingClusters << "," << frame.requiredPages << ","
+                   << frame.workingSetBytes << "," << frame.pageFaults << "," << frame.pagesStreamed << ","
+                   << frame.bytesStreamed << "," << frame.pagesEvicted << "," << frame.residentBytes << "\n";
+      }
+      std::cout << f << ": " << report.numPages << " pages (" << report.totalBytes << " bytes, " << report.pinnedBytes
+                << " pinned), peak working set " << report.peakWorkingSetBytes << " bytes, " << report.totalPageFaults
+                << " page faults, " << report.totalBytesStreamed << " bytes streamed over " << report.frames.size()
+                << " frames\n";
+    }
+  }
+
+  if (!cacheDirectory.empty()) {
+    std::cout << "cache: " << cacheStatistics.hits << " hits, " << cacheStatistics.misses << " misses, "
+              << cacheStatistics.bytesRead << " bytes read, " << cacheStatistics.bytesWritten << " bytes written, " << cacheStatistics.writeFailures << " write failures\n";
   }
 
   return 0;
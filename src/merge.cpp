@@ -0,0 +1,109 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "impl.hpp"
+
+namespace trichi {
+ClusterHierarchy mergeClusterHierarchies(const std::vector<ClusterHierarchy>& hierarchies, const std::vector<float>& vertices, const size_t vertexStride, const Params& params) {
+  if ((vertices.size() * sizeof(float)) % vertexStride != 0) {
+    throw std::runtime_error("invalid vertex stride");
+  }
+  const size_t vertexCount = (vertices.size() * sizeof(float)) / vertexStride;
+
+  size_t numClusters = 0;
+  size_t numVertices = 0;
+  size_t numTriangles = 0;
+  size_t numGroups = 0;
+  for (const auto& hierarchy : hierarchies) {
+    const size_t hierarchyClusters = hierarchy.clusters.size();
+    if (hierarchy.nodes.size() != hierarchyClusters || hierarchy.errors.size() != hierarchyClusters || hierarchy.bounds.size() != hierarchyClusters) {
+      throw std::runtime_error("could not merge hierarchies: number of nodes, clusters and errors differ");
+    }
+    if (!hierarchy.vertices.empty() && *std::max_element(hierarchy.vertices.cbegin(), hierarchy.vertices.cend()) >= vertexCount) {
+      throw std::runtime_error("could not merge hierarchies: index out of range");
+    }
+    numClusters += hierarchyClusters;
+    numVertices += hierarchy.vertices.size();
+    numTriangles += (hierarchy.triangles.size() + 3) & ~static_cast<size_t>(3);
+    numGroups += hierarchy.groupBounds.size();
+  }
+  if (numClusters >= std::numeric_limits<uint32_t>::max() / 2) {
+    throw std::runtime_error("too many clusters");
+  }
+
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+
+  // the hierarchies are concatenated, so that each keeps its clusters, nodes & groups in order
+  ClusterHierarchy merged{};
+  Buffers buffers{};
+  buffers.clusters.reserve(numClusters);
+  buffers.vertices.reserve(numVertices);
+  buffers.triangles.reserve(numTriangles);
+  merged.nodes.reserve(numClusters);
+  merged.errors.reserve(numClusters);
+  merged.bounds.reserve(numClusters);
+  merged.materials.reserve(numClusters);
+  merged.groupBounds.reserve(numGroups);
+  std::vector<std::vector<ClusterIndex>> levelRoots{};
+  for (const auto& hierarchy : hierarchies) {
+    const size_t clusterOffset = buffers.clusters.size();
+    const size_t groupOffset = merged.groupBounds.size();
+    const auto vertexOffset = static_cast<unsigned int>(buffers.vertices.size());
+    const auto triangleOffset = static_cast<unsigned int>(buffers.triangles.size());
+    for (const auto& cluster : hierarchy.clusters) {
+      auto& mergedCluster = buffers.clusters.emplace_back(cluster);
+      mergedCluster.vertexOffset += vertexOffset;
+      mergedCluster.triangleOffset += triangleOffset;
+    }
+    buffers.vertices.insert(buffers.vertices.cend(), hierarchy.vertices.cbegin(), hierarchy.vertices.cend());
+    buffers.triangles.insert(buffers.triangles.cend(), hierarchy.triangles.cbegin(), hierarchy.triangles.cend());
+    buffers.triangles.resize((buffers.triangles.size() + 3) & ~static_cast<size_t>(3), 0);
+
+    for (const auto& node : hierarchy.nodes) {
+      auto& mergedNode = merged.nodes.emplace_back(node);
+      mergedNode.clusterIndex += clusterOffset;
+      mergedNode.childGroupIndex += node.childNodeIndices.empty() ? 0 : groupOffset;
+      for (auto& child : mergedNode.childNodeIndices) {
+        child += clusterOffset;
+      }
+    }
+    merged.errors.insert(merged.errors.cend(), hierarchy.errors.cbegin(), hierarchy.errors.cend());
+    merged.bounds.insert(merged.bounds.cend(), hierarchy.bounds.cbegin(), hierarchy.bounds.cend());
+    if (hierarchy.materials.size() == hierarchy.clusters.size()) {
+      merged.materials.insert(merged.materials.cend(), hierarchy.materials.cbegin(), hierarchy.materials.cend());
+    } else {
+      merged.materials.insert(merged.materials.cend(), hierarchy.clusters.size(), 0);
+    }
+    merged.groupBounds.insert(merged.groupBounds.cend(), hierarchy.groupBounds.cbegin(), hierarchy.groupBounds.cend());
+
+    // roots join the shared levels on the level they were built on, so that coarser roots are not grouped with finer ones
+    const auto levels = computeNodeLevels(hierarchy);
+    for (const size_t rootNode : hierarchy.rootNodes) {
+      if (levels[rootNode] >= levelRoots.size()) {
+        levelRoots.resize(levels[rootNode] + 1);
+      }
+      levelRoots[levels[rootNode]].emplace_back(static_cast<ClusterIndex>(clusterOffset + rootNode));
+    }
+  }
+
+  const bool packedPositions = shouldPackPositions(vertexCount, vertexStride);
+  const std::vector<float> positionStream = packedPositions ? packPositions(vertices, vertexCount, vertexStride, loopRunner) : std::vector<float>{};
+  const std::vector<float>& positions = packedPositions ? positionStream : vertices;
+  const size_t positionStride = packedPositions ? 3 * sizeof(float) : vertexStride;
+
+  // tiles are connected by the vertices they share, so that their roots are grouped across tile borders
+  auto rootNodes = extendClusterHierarchy(merged, buffers, levelRoots, positions, vertexCount, positionStride, params, loopRunner);
+  std::sort(rootNodes.begin(), rootNodes.end());
+  merged.rootNodes.assign(rootNodes.cbegin(), rootNodes.cend());
+
+  merged.clusters = std::move(buffers.clusters);
+  merged.vertices = std::move(buffers.vertices);
+  merged.triangles = std::move(buffers.triangles);
+  return std::move(merged);
+}
+}  // namespace trichi
@@ -3,9 +3,9 @@
 * SPDX-License-Identifier: MIT
 */
 
+#include <algorithm>
 #include <array>
-#include <atomic>
-#include <chrono>
+#include <numeric>
 
 #include "metis.h"
 
@@ -19,77 +19,86 @@ struct Graph {
   bool isContiguous;
 };
 
-[[nodiscard]] Graph buildClusterGraph(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner) {
+/**
+ * Builds the adjacency graph of the given clusters, where the weight of an edge is the length of the two clusters' shared boundary.
+ * Adjacent clusters are found by matching their boundary edges, so this scales with the number of boundary edges instead of quadratically with the number of clusters.
+ */
+[[nodiscard]] Graph buildClusterGraphFromSharedEdges(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, LoopRunner& loopRunner) {
   const auto boundaries = extractBoundaries(clusterIndices, buffers, loopRunner);
 
-  std::atomic<size_t> adjacencySize = 0;
-
-  std::vector<idx_t> valenceForward( clusterIndices.size(), 0);
-  std::vector<std::vector<idx_t>> adjacencyForward{clusterIndices.size()};
-  std::vector<std::vector<idx_t>> adjwghtForward{clusterIndices.size()};
-
-  // forward pass on adjacency edge weights - this is expensive, so we do this in parallel
-  // (doing a parallel forward and a sequential resolve pass is ~5s faster for 4m tris than doing a parallel bidirectional pass on my machine)
-  loopRunner.loop(0, boundaries.size(), [&](const size_t i) {
-    const auto& boundary = boundaries[i];
-    // loop over vertices that have not been processed yet
-    for (size_t j = i + 1; j < boundaries.size(); ++j) {
-      if (const auto sharedBoundaryLength = intersectionSize(boundary, boundaries[j]); sharedBoundaryLength > 0) {
-        ++valenceForward[i];
-        adjacencyForward[i].push_back(static_cast<idx_t>(j));
-        adjwghtForward[i].push_back(static_cast<idx_t>(sharedBoundaryLength));
-      }
+  // each boundary edge is stored once per cluster, so clusters sharing an edge end up next to each other
+  std::vector<std::pair<uint64_t, uint32_t>> edgeClusters{};
+  edgeClusters.reserve(std::accumulate(boundaries.sizes.cbegin(), boundaries.sizes.cend(), static_cast<size_t>(0)));
+  for (size_t i = 0; i < boundaries.size(); ++i) {
+    for (const uint64_t edge : boundaries[i]) {
+      edgeClusters.emplace_back(edge, static_cast<uint32_t>(i));
     }
-    adjacencySize += adjacencyForward[i].size() * 2;
-  });
-
-  bool isContiguous = true;
-
-  // stores the resolved adjacency_forward & edge weights
-  std::vector<idx_t> xadj( clusterIndices.size() + 1, 0);
-  std::vector<idx_t> adjacency{};
-  std::vector<idx_t> adjwght{};
-  adjacency.reserve(adjacencySize);
-  adjwght.reserve(adjacencySize);
+  }
+  std::sort(edgeClusters.begin(), edgeClusters.end());
 
-  // temp vectors to store adjacency_forward & edge weights from earlier nodes (we need each edge in both directions)
-  std::vector<std::vector<idx_t>> adjacencyPrev{clusterIndices.size()};
-  std::vector<std::vector<idx_t>> adjwghtPrev{clusterIndices.size()};
+  // each pair of clusters sharing an edge is stored in both directions, so that the number of equal pairs is the length of their shared boundary
+  std::vector<std::pair<uint32_t, uint32_t>> clusterPairs{};
+  for (size_t begin = 0; begin < edgeClusters.size();) {
+    size_t end = begin + 1;
+    while (end < edgeClusters.size() && edgeClusters[end].first == edgeClusters[begin].first) {
+      ++end;
+    }
+    for (size_t a = begin; a < end; ++a) {
+      for (size_t b = a + 1; b < end; ++b) {
+        clusterPairs.emplace_back(edgeClusters[a].second, edgeClusters[b].second);
+        clusterPairs.emplace_back(edgeClusters[b].second, edgeClusters[a].second);
+      }
+    }
+    begin = end;
+  }
+  std::sort(clusterPairs.begin(), clusterPairs.end());
 
-  // resolve adjacency_forward & edge weights
-  for (size_t i = 0; i < boundaries.size(); ++i) {
-    const idx_t valence = valenceForward[i] + static_cast<idx_t>(adjacencyPrev[i].size());
-    if (valence == 0) {
-      isContiguous = false;
-    }
-    xadj[i + 1] += valence + xadj[i];
-    for (size_t j = 0; j < adjacencyForward[i].size(); ++j) {
-      adjacencyPrev[adjacencyForward[i][j]].push_back(static_cast<idx_t>(i));
-      adjwghtPrev[adjacencyForward[i][j]].push_back(adjwghtForward[i][j]);
-    }
-    adjacency.insert(adjacency.cend(), adjacencyPrev[i].cbegin(), adjacencyPrev[i].cend());
-    adjwght.insert(adjwght.cend(), adjwghtPrev[i].cbegin(), adjwghtPrev[i].cend());
-    adjacency.insert(adjacency.cend(), adjacencyForward[i].cbegin(), adjacencyForward[i].cend());
-    adjwght.insert(adjwght.cend(), adjwghtForward[i].cbegin(), adjwghtForward[i].cend());
-  }
-
-  return Graph{
-      .xadj = std::move(xadj),
-      .adjacency = std::move(adjacency),
-      .adjwght = std::move(adjwght),
-      .isContiguous = isContiguous,
+  // sorted pairs are already in CSR order with ascending neighbors
+  Graph graph{
+      .xadj = std::vector<idx_t>(clusterIndices.size() + 1, 0),
+      .adjacency = {},
+      .adjwght = {},
+      .isContiguous = true,
   };
+  for (size_t begin = 0; begin < clusterPairs.size();) {
+    size_t end = begin + 1;
+    while (end < clusterPairs.size() && clusterPairs[end] == clusterPairs[begin]) {
+      ++end;
+    }
+    ++graph.xadj[clusterPairs[begin].first + 1];
+    graph.adjacency.emplace_back(static_cast<idx_t>(clusterPairs[begin].second));
+    graph.adjwght.emplace_back(static_cast<idx_t>(end - begin));
+    begin = end;
+  }
+  for (size_t i = 0; i < clusterIndices.size(); ++i) {
+    if (graph.xadj[i + 1] == 0) {
+      graph.isContiguous = false;
+    }
+    graph.xadj[i + 1] += graph.xadj[i];
+  }
+  return std::move(graph);
 }
 
-[[nodiscard]] std::vector<std::vector<size_t>> resolveGroups(const std::vector<idx_t>& partition, const size_t numGroups) {
-  auto groups = std::vector<std::vector<size_t>>(numGroups);
+[[nodiscard]] IndexGroups resolveGroups(const std::vector<idx_t>& partition, const size_t numGroups) {
+  // counting sort of the partition's vertices by group
+  IndexGroups groups{};
+  groups.offsets.assign(numGroups + 1, 0);
+  for (const idx_t group : partition) {
+    ++groups.offsets[group + 1];
+  }
+  for (size_t i = 0; i < numGroups; ++i) {
+    groups.offsets[i + 1] += groups.offsets[i];
+  }
+  groups.indices.resize(partition.size());
+  std::vector<uint32_t> groupSizes(numGroups, 0);
   for (size_t i = 0; i < partition.size(); ++i) {
-    groups[partition[i]].push_back(i);
+    const auto group = static_cast<size_t>(partition[i]);
+    groups.indices[groups.offsets[group] + groupSizes[group]++] = static_cast<uint32_t>(i);
   }
   return std::move(groups);
 }
 
-[[nodiscard]] std::array<idx_t, METIS_NOPTIONS> createPartitionOptions(const bool isContiguous = true) {
+[[nodiscard]] std::array<idx_t, METIS_NOPTIONS> createPartitionOptions(const bool isContiguous = true, const uint32_t seed = 0) {
   std::array<idx_t, METIS_NOPTIONS> options{};
   METIS_SetDefaultOptions(options.data());
   options[METIS_OPTION_OBJTYPE] =
@@ -108,7 +117,7 @@ struct Graph {
   //options[METIS_OPTION_UFACTOR] = 0; // default for rb = 1, kway = 30
   //options[METIS_OPTION_MINCONN] = 0; // 1 -> explicitly minimize connectivity between groups
   options[METIS_OPTION_CONTIG] = idx_t(isContiguous);  // 1 -> force contiguous partitions
-  //options[METIS_OPTION_SEED] = 0; // seed for rng
+  options[METIS_OPTION_SEED] = static_cast<idx_t>(seed & 0x7fffffff);  // seed for rng - always set explicitly, so results never depend on METIS' defaults
   options[METIS_OPTION_NUMBERING] = 0;  // 0 -> result is 0-indexed
 #ifndef NDEBUG
   options[METIS_OPTION_DBGLVL] |= METIS_DBG_INFO;
@@ -118,13 +127,13 @@ struct Graph {
 }
 
 // todo: mt-kahypar (https://github.com/kahypar/mt-kahypar) looks very promising for graph partitioning - no static lib though, so needs some work for wasm build
-[[nodiscard]] std::vector<std::vector<size_t>> partitionGraph(Graph graph, const size_t maxClustersPerGroup) {
+[[nodiscard]] IndexGroups partitionGraph(Graph graph, const size_t maxClustersPerGroup, const uint32_t seed) {
   auto numVertices = static_cast<idx_t>(graph.xadj.size() - 1);
   idx_t numConstraints = 1;  // 1 is the minimum allowed value
   idx_t numParts = std::max(numVertices / static_cast<idx_t>(maxClustersPerGroup), 2);
   idx_t edgeCut = 0;
   std::vector<idx_t> partition = std::vector<idx_t>(numVertices, 0);
-  std::array<idx_t, METIS_NOPTIONS> options = createPartitionOptions(graph.isContiguous);
+  std::array<idx_t, METIS_NOPTIONS> options = createPartitionOptions(graph.isContiguous, seed);
 
   const auto partitionResult = METIS_PartGraphKway(
       &numVertices,            // number of vertices
@@ -155,13 +164,258 @@ struct Graph {
   return resolveGroups(partition, numParts);
 }
 
-[[nodiscard]] std::vector<std::vector<size_t>> groupClusters(
+/**
+ * The minimum number of clusters per region when grouping clusters by region, so that partitioning a region outweighs the cost of splitting the graph.
+ */
+constexpr size_t kMinClustersPerRegion = 1024;
+
+/**
+ * Splits clusters into spatial regions of roughly equal size by recursively splitting them at the median of their bounds' centers along the longest axis.
+ *
+ * @return Returns the region of each cluster.
+ */
+[[nodiscard]] std::vector<uint32_t> splitIntoRegions(
+    const std::vector<ClusterIndex>& clusterIndices,
+    const std::vector<ClusterBounds>& clusterBounds,
+    const size_t numRegions) {
+  const auto center = [&](const uint32_t i) {
+    return clusterBounds[clusterIndices[i]].center;
+  };
+
+  std::vector<uint32_t> order(clusterIndices.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<uint32_t> regions(clusterIndices.size(), 0);
+
+  // each range of clusters is split into two ranges with a number of clusters proportional to their number of regions
+  struct Range {
+    size_t begin;
+    size_t end;
+    size_t firstRegion;
+    size_t numRegions;
+  };
+  std::vector<Range> stack{{0, order.size(), 0, numRegions}};
+  while (!stack.empty()) {
+    const auto range = stack.back();
+    stack.pop_back();
+    if (range.numRegions <= 1) {
+      for (size_t i = range.begin; i < range.end; ++i) {
+        regions[order[i]] = static_cast<uint32_t>(range.firstRegion);
+      }
+      continue;
+    }
+
+    float aabbMin[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float aabbMax[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (size_t i = range.begin; i < range.end; ++i) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        aabbMin[axis] = std::min(aabbMin[axis], center(order[i])[axis]);
+        aabbMax[axis] = std::max(aabbMax[axis], center(order[i])[axis]);
+      }
+    }
+    size_t splitAxis = 0;
+    for (size_t axis = 1; axis < 3; ++axis) {
+      if (aabbMax[axis] - aabbMin[axis] > aabbMax[splitAxis] - aabbMin[splitAxis]) {
+        splitAxis = axis;
+      }
+    }
+
+    const size_t numLeftRegions = range.numRegions / 2;
+    const size_t split = range.begin + (range.end - range.begin) * numLeftRegions / range.numRegions;
+    std::nth_element(
+        order.begin() + static_cast<ptrdiff_t>(range.begin),
+        order.begin() + static_cast<ptrdiff_t>(split),
+        order.begin() + static_cast<ptrdiff_t>(range.end),
+        [&](const uint32_t a, const uint32_t b) {
+          return center(a)[splitAxis] != center(b)[splitAxis] ? center(a)[splitAxis] < center(b)[splitAxis] : a < b;
+        });
+    stack.push_back({range.begin, split, range.firstRegion, numLeftRegions});
+    stack.push_back({split, range.end, range.firstRegion + numLeftRegions, range.numRegions - numLeftRegions});
+  }
+  return std::move(regions);
+}
+
+/**
+ * Extracts the subgraph induced by the given vertices.
+ *
+ * @param graph the graph
+ * @param vertices the subgraph's vertices in the graph
+ * @param localIndices the index of each of the graph's vertices in its region
+ * @param regions the region of each of the graph's vertices
+ * @param region the region of the subgraph's vertices
+ */
+[[nodiscard]] Graph extractSubgraph(
+    const Graph& graph,
+    const std::span<const uint32_t> vertices,
+    const std::vector<uint32_t>& localIndices,
+    const std::vector<uint32_t>& regions,
+    const uint32_t region) {
+  Graph subgraph{
+      .xadj = std::vector<idx_t>(vertices.size() + 1, 0),
+      .adjacency = {},
+      .adjwght = {},
+      .isContiguous = true,
+  };
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const uint32_t vertex = vertices[i];
+    for (idx_t e = graph.xadj[vertex]; e < graph.xadj[vertex + 1]; ++e) {
+      const auto neighbor = static_cast<uint32_t>(graph.adjacency[e]);
+      if (regions[neighbor] == region) {
+        subgraph.adjacency.emplace_back(static_cast<idx_t>(localIndices[neighbor]));
+        subgraph.adjwght.emplace_back(graph.adjwght[e]);
+      }
+    }
+    subgraph.xadj[i + 1] = static_cast<idx_t>(subgraph.adjacency.size());
+    if (subgraph.xadj[i + 1] == subgraph.xadj[i]) {
+      subgraph.isContiguous = false;
+    }
+  }
+  return std::move(subgraph);
+}
+
+/**
+ * Groups a graph's vertices by splitting the graph into spatial regions that are partitioned in parallel.
+ * Groups that are too small after partitioning the regions and that touch another region are merged with their most strongly connected neighbor group.
+ */
+[[nodiscard]] IndexGroups partitionGraphByRegion(
+    const Graph& graph,
+    const std::vector<ClusterIndex>& clusterIndices,
+    const std::vector<ClusterBounds>& clusterBounds,
+    const size_t numRegions,
+    const size_t maxClustersPerGroup,
+    const uint32_t seed,
+    LoopRunner& loopRunner) {
+  const auto regions = splitIntoRegions(clusterIndices, clusterBounds, numRegions);
+  IndexGroups regionVertices = resolveGroups(std::vector<idx_t>(regions.cbegin(), regions.cend()), numRegions);
+  std::vector<uint32_t> localIndices(regions.size());
+  for (size_t region = 0; region < numRegions; ++region) {
+    const auto vertices = regionVertices[region];
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      localIndices[vertices[i]] = static_cast<uint32_t>(i);
+    }
+  }
+
+  std::vector<IndexGroups> regionGroups(numRegions);
+  loopRunner.loop(0, numRegions, [&](const size_t region) {
+    const auto vertices = regionVertices[region];
+    if (vertices.size() <= maxClustersPerGroup) {
+      regionGroups[region].append(std::vector<uint32_t>(vertices.begin(), vertices.end()));
+      return;
+    }
+    const auto groups = partitionGraph(extractSubgraph(graph, vertices, localIndices, regions, static_cast<uint32_t>(region)), maxClustersPerGroup, seed);
+    for (size_t g = 0; g < groups.size(); ++g) {
+      std::vector<uint32_t> group{};
+      for (const uint32_t localIndex : groups[g]) {
+        group.emplace_back(vertices[localIndex]);
+      }
+      regionGroups[region].append(group);
+    }
+  });
+
+  // all groups in region order
+  std::vector<uint32_t> vertexGroups(regions.size());
+  IndexGroups groups{};
+  for (const auto& region : regionGroups) {
+    for (size_t g = 0; g < region.size(); ++g) {
+      for (const uint32_t vertex : region[g]) {
+        vertexGroups[vertex] = static_cast<uint32_t>(groups.size());
+      }
+      groups.append(region[g]);
+    }
+  }
+
+  // small groups at region borders are merged into the neighbor group they share the longest boundary with
+  const size_t minGroupSize = (maxClustersPerGroup + 1) / 2;
+  const size_t maxMergedGroupSize = maxClustersPerGroup + maxClustersPerGroup / 2;
+  std::vector<uint32_t> mergedInto(groups.size());
+  std::iota(mergedInto.begin(), mergedInto.end(), 0);
+  std::vector<size_t> groupSizes(groups.size());
+  for (size_t g = 0; g < groups.size(); ++g) {
+    groupSizes[g] = groups[g].size();
+  }
+  const auto findGroup = [&](uint32_t g) {
+    while (mergedInto[g] != g) {
+      g = mergedInto[g];
+    }
+    return g;
+  };
+  std::vector<std::pair<uint32_t, idx_t>> neighborWeights{};
+  for (size_t g = 0; g < groups.size(); ++g) {
+    if (groupSizes[g] >= minGroupSize) {
+      continue;
+    }
+    bool touchesOtherRegion = false;
+    neighborWeights.clear();
+    for (const uint32_t vertex : groups[g]) {
+      for (idx_t e = graph.xadj[vertex]; e < graph.xadj[vertex + 1]; ++e) {
+        const auto neighbor = static_cast<uint32_t>(graph.adjacency[e]);
+        touchesOtherRegion = touchesOtherRegion || regions[neighbor] != regions[vertex];
+        const uint32_t neighborGroup = findGroup(vertexGroups[neighbor]);
+        if (neighborGroup != g) {
+          neighborWeights.emplace_back(neighborGroup, graph.adjwght[e]);
+        }
+      }
+    }
+    if (!touchesOtherRegion || neighborWeights.empty()) {
+      continue;
+    }
+    std::sort(neighborWeights.begin(), neighborWeights.end());
+    uint32_t bestGroup = 0;
+    idx_t bestWeight = 0;
+    for (size_t i = 0; i < neighborWeights.size();) {
+      const uint32_t neighborGroup = neighborWeights[i].first;
+      idx_t weight = 0;
+      for (; i < neighborWeights.size() && neighborWeights[i].first == neighborGroup; ++i) {
+        weight += neighborWeights[i].second;
+      }
+      if (weight > bestWeight && groupSizes[neighborGroup] + groupSizes[g] <= maxMergedGroupSize) {
+        bestGroup = neighborGroup;
+        bestWeight = weight;
+      }
+    }
+    if (bestWeight > 0) {
+      mergedInto[g] = bestGroup;
+      groupSizes[bestGroup] += groupSizes[g];
+    }
+  }
+
+  // merged groups are stored in place of the group they were merged into
+  std::vector<std::vector<uint32_t>> mergedGroups(groups.size());
+  for (size_t g = 0; g < groups.size(); ++g) {
+    auto& mergedGroup = mergedGroups[findGroup(static_cast<uint32_t>(g))];
+    mergedGroup.insert(mergedGroup.end(), groups[g].begin(), groups[g].end());
+  }
+  IndexGroups result{};
+  for (auto& group : mergedGroups) {
+    if (!group.empty()) {
+      std::sort(group.begin(), group.end());
+      result.append(group);
+    }
+  }
+  return std::move(result);
+}
+
+[[nodiscard]] IndexGroups groupClusters(
     const std::vector<ClusterIndex>& clusterIndices,
     const Buffers& buffers,
+    const std::vector<ClusterBounds>& clusterBounds,
     const size_t maxClustersPerGroup,
+    const size_t numRegions,
+    const uint32_t seed,
     LoopRunner& loopRunner) {
-  return std::move(partitionGraph(
-      std::move(buildClusterGraph(clusterIndices, buffers, loopRunner)),
-      maxClustersPerGroup));
+  const size_t numUsedRegions = std::min(numRegions, clusterIndices.size() / kMinClustersPerRegion);
+  if (numUsedRegions <= 1) {
+    return std::move(partitionGraph(
+        buildClusterGraphFromSharedEdges(clusterIndices, buffers, loopRunner),
+        maxClustersPerGroup,
+        seed));
+  }
+  return std::move(partitionGraphByRegion(
+      buildClusterGraphFromSharedEdges(clusterIndices, buffers, loopRunner),
+      clusterIndices,
+      clusterBounds,
+      numUsedRegions,
+      maxClustersPerGroup,
+      seed,
+      loopRunner));
 }
 }  // namespace trichi
\ No newline at end of file
@@ -0,0 +1,172 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <unordered_map>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Sorts clusters by the first page of their unit (see `StreamingLayout`), keeping the hierarchy's order within each page.
+ * The groups store cluster indices.
+ */
+[[nodiscard]] IndexGroups groupClustersByPage(const ClusterHierarchy& hierarchy, const StreamingLayout& layout) {
+  IndexGroups pageClusters{};
+  pageClusters.offsets.assign(layout.pages.size() + 1, 0);
+  for (size_t clusterIndex = 0; clusterIndex < hierarchy.clusters.size(); ++clusterIndex) {
+    ++pageClusters.offsets[layout.firstPage(clusterIndex) + 1];
+  }
+  for (size_t page = 0; page < layout.pages.size(); ++page) {
+    pageClusters.offsets[page + 1] += pageClusters.offsets[page];
+  }
+  std::vector<uint32_t> nextSlots(pageClusters.offsets.cbegin(), pageClusters.offsets.cend() - 1);
+  pageClusters.indices.resize(hierarchy.clusters.size());
+  for (size_t clusterIndex = 0; clusterIndex < hierarchy.clusters.size(); ++clusterIndex) {
+    pageClusters.indices[nextSlots[layout.firstPage(clusterIndex)]++] = static_cast<uint32_t>(clusterIndex);
+  }
+  return std::move(pageClusters);
+}
+
+/**
+ * Numbers vertices by first use within each page, duplicating vertices that are used by multiple pages.
+ */
+[[nodiscard]] std::vector<uint32_t> remapVerticesPerPage(ClusterHierarchy& hierarchy, const IndexGroups& pageClusters, LoopRunner& loopRunner) {
+  // each page numbers its own vertices, which are offset by all previous pages' vertices afterward
+  std::vector<std::vector<uint32_t>> pageVertices(pageClusters.size());
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    std::unordered_map<uint32_t, uint32_t> localIndices{};
+    for (const uint32_t clusterIndex : pageClusters[page]) {
+      const auto& cluster = hierarchy.clusters[clusterIndex];
+      for (size_t i = cluster.vertexOffset; i < cluster.vertexOffset + cluster.vertexCount; ++i) {
+        const auto [it, inserted] = localIndices.try_emplace(hierarchy.vertices[i], static_cast<uint32_t>(pageVertices[page].size()));
+        if (inserted) {
+          pageVertices[page].emplace_back(hierarchy.vertices[i]);
+        }
+        hierarchy.vertices[i] = it->second;
+      }
+    }
+  });
+
+  std::vector<size_t> pageOffsets(pageClusters.size() + 1, 0);
+  for (size_t page = 0; page < pageClusters.size(); ++page) {
+    pageOffsets[page + 1] = pageOffsets[page] + pageVertices[page].size();
+  }
+
+  std::vector<uint32_t> sourceVertices(pageOffsets.back());
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    const auto pageOffset = static_cast<uint32_t>(pageOffsets[page]);
+    std::copy(pageVertices[page].cbegin(), pageVertices[page].cend(), sourceVertices.begin() + static_cast<ptrdiff_t>(pageOffset));
+    for (const uint32_t clusterIndex : pageClusters[page]) {
+      const auto& cluster = hierarchy.clusters[clusterIndex];
+      for (size_t i = cluster.vertexOffset; i < cluster.vertexOffset + cluster.vertexCount; ++i) {
+        hierarchy.vertices[i] += pageOffset;
+      }
+    }
+  });
+  return std::move(sourceVertices);
+}
+
+/**
+ * Numbers vertices by their first use over all pages.
+ */
+[[nodiscard]] std::vector<uint32_t> remapVertices(ClusterHierarchy& hierarchy, const IndexGroups& pageClusters, const size_t numVertices, LoopRunner& loopRunner) {
+  // each vertex reference has a position in page order
+  std::vector<uint32_t> pageReferenceOffsets(pageClusters.size() + 1, 0);
+  for (size_t page = 0; page < pageClusters.size(); ++page) {
+    uint32_t numReferences = 0;
+    for (const uint32_t clusterIndex : pageClusters[page]) {
+      numReferences += hierarchy.clusters[clusterIndex].vertexCount;
+    }
+    pageReferenceOffsets[page + 1] = pageReferenceOffsets[page] + numReferences;
+  }
+  const auto forEachReference = [&](const size_t page, auto&& body) {
+    uint32_t position = pageReferenceOffsets[page];
+    for (const uint32_t clusterIndex : pageClusters[page]) {
+      const auto& cluster = hierarchy.clusters[clusterIndex];
+      for (size_t i = cluster.vertexOffset; i < cluster.vertexOffset + cluster.vertexCount; ++i) {
+        body(i, position++);
+      }
+    }
+  };
+
+  // a vertex's first use is the lowest position it is referenced at
+  std::vector<std::atomic_uint32_t> firstUses(numVertices);
+  for (auto& firstUse : firstUses) {
+    firstUse.store(std::numeric_limits<uint32_t>::max(), std::memory_order_relaxed);
+  }
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    forEachReference(page, [&](const size_t i, const uint32_t position) {
+      auto& firstUse = firstUses[hierarchy.vertices[i]];
+      uint32_t current = firstUse.load(std::memory_order_relaxed);
+      while (position < current && !firstUse.compare_exchange_weak(current, position, std::memory_order_relaxed)) {}
+    });
+  });
+
+  std::vector<uint32_t> pageFirstUses(pageClusters.size() + 1, 0);
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    forEachReference(page, [&](const size_t i, const uint32_t position) {
+      if (firstUses[hierarchy.vertices[i]].load(std::memory_order_relaxed) == position) {
+        ++pageFirstUses[page + 1];
+      }
+    });
+  });
+  for (size_t page = 0; page < pageClusters.size(); ++page) {
+    pageFirstUses[page + 1] += pageFirstUses[page];
+  }
+
+  // only the first use of each vertex writes its new index, so pages don't conflict
+  std::vector<uint32_t> newIndices(numVertices, 0);
+  std::vector<uint32_t> sourceVertices(pageFirstUses.back());
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    uint32_t next = pageFirstUses[page];
+    forEachReference(page, [&](const size_t i, const uint32_t position) {
+      const uint32_t vertexIndex = hierarchy.vertices[i];
+      if (firstUses[vertexIndex].load(std::memory_order_relaxed) == position) {
+        newIndices[vertexIndex] = next;
+        sourceVertices[next++] = vertexIndex;
+      }
+    });
+  });
+  loopRunner.loop(0, pageClusters.size(), [&](const size_t page) {
+    forEachReference(page, [&](const size_t i, const uint32_t) {
+      hierarchy.vertices[i] = newIndices[hierarchy.vertices[i]];
+    });
+  });
+  return std::move(sourceVertices);
+}
+
+std::vector<uint32_t> reorderVertices(ClusterHierarchy& hierarchy, std::vector<float>& vertices, const size_t vertexStride, const VertexReorderParams& params) {
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  const size_t numVertices = vertices.size() / floatsPerVertex;
+  for (const auto& cluster : hierarchy.clusters) {
+    for (size_t i = cluster.vertexOffset; i < cluster.vertexOffset + cluster.vertexCount; ++i) {
+      if (hierarchy.vertices[i] >= numVertices) {
+        throw std::runtime_error("could not reorder vertices: index out of range");
+      }
+    }
+  }
+
+  const StreamingLayout layout{hierarchy, StreamingParams{
+      .pageSizeBytes = params.pageSizeBytes,
+      .vertexSizeBytes = vertexStride,
+  }};
+  const auto pageClusters = groupClustersByPage(hierarchy, layout);
+
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  auto sourceVertices = params.duplicateVerticesPerPage
+      ? remapVerticesPerPage(hierarchy, pageClusters, loopRunner)
+      : remapVertices(hierarchy, pageClusters, numVertices, loopRunner);
+
+  std::vector<float> reorderedVertices(sourceVertices.size() * floatsPerVertex);
+  loopRunner.loop(0, sourceVertices.size(), [&](const size_t i) {
+    std::copy_n(&vertices[sourceVertices[i] * floatsPerVertex], floatsPerVertex, &reorderedVertices[i * floatsPerVertex]);
+  });
+  vertices = std::move(reorderedVertices);
+  return std::move(sourceVertices);
+}
+}  // namespace trichi
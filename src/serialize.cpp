@@ -0,0 +1,234 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "trichi.hpp"
+
+namespace trichi {
+constexpr std::array<uint8_t, 4> kMagic = {'T', 'R', 'C', 'H'};
+constexpr uint32_t kFormatVersion = 3;
+
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::vector<uint8_t>& bytes) : bytes(bytes) {}
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    writeBytes(&value, sizeof(T));
+  }
+
+  template <typename T>
+  void writeArray(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+
+ private:
+  void writeBytes(const void* data, const size_t size) {
+    const size_t offset = bytes.size();
+    bytes.resize(offset + size);
+    if (size > 0) {
+      std::memcpy(&bytes[offset], data, size);
+    }
+  }
+
+  std::vector<uint8_t>& bytes;
+};
+
+class ByteReader {
+ public:
+  ByteReader(const uint8_t* data, const size_t size) : data(data), size(size) {}
+
+  template <typename T>
+  [[nodiscard]] T read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value{};
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  [[nodiscard]] std::vector<T> readArray(const uint64_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count > (size - offset) / sizeof(T)) {
+      throw std::runtime_error("invalid cluster hierarchy - unexpected end of data");
+    }
+    std::vector<T> values(count);
+    readBytes(values.data(), count * sizeof(T));
+    return std::move(values);
+  }
+
+ private:
+  void readBytes(void* destination, const size_t count) {
+    if (count > size - offset) {
+      throw std::runtime_error("invalid cluster hierarchy - unexpected end of data");
+    }
+    if (count > 0) {
+      std::memcpy(destination, data + offset, count);
+    }
+    offset += count;
+  }
+
+  const uint8_t* data;
+  size_t size;
+  size_t offset = 0;
+};
+
+/**
+ * Checks that all indices & offsets stored in a deserialized hierarchy are within the bounds of the arrays they refer to.
+ * Array lengths alone don't catch stale or corrupt data that happens to have the right size.
+ */
+void validateClusterHierarchy(const ClusterHierarchy& hierarchy) {
+  const size_t numClusters = hierarchy.clusters.size();
+  if (hierarchy.errors.size() != numClusters || hierarchy.bounds.size() != numClusters) {
+    throw std::runtime_error("invalid cluster hierarchy - number of error bounds or cluster bounds does not match number of clusters");
+  }
+  if (!hierarchy.materials.empty() && hierarchy.materials.size() != numClusters) {
+    throw std::runtime_error("invalid cluster hierarchy - number of materials does not match number of clusters");
+  }
+  for (const auto& node : hierarchy.nodes) {
+    if (node.clusterIndex >= numClusters) {
+      throw std::runtime_error("invalid cluster hierarchy - cluster index out of range");
+    }
+    if (!node.childNodeIndices.empty() && node.childGroupIndex >= hierarchy.groupBounds.size()) {
+      throw std::runtime_error("invalid cluster hierarchy - child group index out of range");
+    }
+    for (const size_t child : node.childNodeIndices) {
+      if (child >= hierarchy.nodes.size()) {
+        throw std::runtime_error("invalid cluster hierarchy - child node index out of range");
+      }
+    }
+  }
+  for (const size_t root : hierarchy.rootNodes) {
+    if (root >= hierarchy.nodes.size()) {
+      throw std::runtime_error("invalid cluster hierarchy - root node index out of range");
+    }
+  }
+  for (const auto& cluster : hierarchy.clusters) {
+    if (static_cast<uint64_t>(cluster.vertexOffset) + cluster.vertexCount > hierarchy.vertices.size() ||
+        static_cast<uint64_t>(cluster.triangleOffset) + static_cast<uint64_t>(cluster.triangleCount) * 3 > hierarchy.triangles.size()) {
+      throw std::runtime_error("invalid cluster hierarchy - cluster out of range");
+    }
+    for (size_t i = 0; i < static_cast<size_t>(cluster.triangleCount) * 3; ++i) {
+      if (hierarchy.triangles[cluster.triangleOffset + i] >= cluster.vertexCount) {
+        throw std::runtime_error("invalid cluster hierarchy - triangle vertex index out of range");
+      }
+    }
+  }
+}
+
+std::vector<uint8_t> serializeClusterHierarchy(const ClusterHierarchy& hierarchy) {
+  // nodes are stored as flat arrays of cluster indices, child group indices, child counts, and child indices
+  std::vector<uint64_t> nodeClusterIndices{};
+  std::vector<uint64_t> nodeChildGroupIndices{};
+  std::vector<uint64_t> nodeChildCounts{};
+  std::vector<uint64_t> childNodeIndices{};
+  nodeClusterIndices.reserve(hierarchy.nodes.size());
+  nodeChildGroupIndices.reserve(hierarchy.nodes.size());
+  nodeChildCounts.reserve(hierarchy.nodes.size());
+  for (const auto& node : hierarchy.nodes) {
+    nodeClusterIndices.emplace_back(node.clusterIndex);
+    nodeChildGroupIndices.emplace_back(node.childGroupIndex);
+    nodeChildCounts.emplace_back(node.childNodeIndices.size());
+    childNodeIndices.insert(childNodeIndices.cend(), node.childNodeIndices.cbegin(), node.childNodeIndices.cend());
+  }
+  const std::vector<uint64_t> rootNodes(hierarchy.rootNodes.cbegin(), hierarchy.rootNodes.cend());
+
+  std::vector<uint8_t> bytes{};
+  bytes.reserve(
+      sizeof(kMagic) + sizeof(kFormatVersion) + 10 * sizeof(uint64_t) +
+      (nodeClusterIndices.size() + nodeChildGroupIndices.size() + nodeChildCounts.size() + childNodeIndices.size() + rootNodes.size()) * sizeof(uint64_t) +
+      hierarchy.errors.size() * sizeof(NodeErrorBounds) +
+      hierarchy.bounds.size() * sizeof(ClusterBounds) +
+      hierarchy.groupBounds.size() * sizeof(GroupBounds) +
+      hierarchy.clusters.size() * sizeof(Cluster) +
+      hierarchy.vertices.size() * sizeof(uint32_t) +
+      hierarchy.triangles.size() * sizeof(uint8_t) +
+      hierarchy.materials.size() * sizeof(uint32_t));
+
+  ByteWriter writer{bytes};
+  writer.write(kMagic);
+  writer.write(kFormatVersion);
+  writer.write(static_cast<uint64_t>(nodeClusterIndices.size()));
+  writer.write(static_cast<uint64_t>(childNodeIndices.size()));
+  writer.write(static_cast<uint64_t>(rootNodes.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.errors.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.bounds.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.groupBounds.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.clusters.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.vertices.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.triangles.size()));
+  writer.write(static_cast<uint64_t>(hierarchy.materials.size()));
+  writer.writeArray(nodeClusterIndices);
+  writer.writeArray(nodeChildGroupIndices);
+  writer.writeArray(nodeChildCounts);
+  writer.writeArray(childNodeIndices);
+  writer.writeArray(rootNodes);
+  writer.writeArray(hierarchy.errors);
+  writer.writeArray(hierarchy.bounds);
+  writer.writeArray(hierarchy.groupBounds);
+  writer.writeArray(hierarchy.clusters);
+  writer.writeArray(hierarchy.vertices);
+  writer.writeArray(hierarchy.triangles);
+  writer.writeArray(hierarchy.materials);
+  return std::move(bytes);
+}
+
+ClusterHierarchy deserializeClusterHierarchy(const uint8_t* data, const size_t size) {
+  ByteReader reader{data, size};
+  if (reader.read<std::array<uint8_t, 4>>() != kMagic) {
+    throw std::runtime_error("invalid cluster hierarchy - unknown format");
+  }
+  if (reader.read<uint32_t>() != kFormatVersion) {
+    throw std::runtime_error("invalid cluster hierarchy - unsupported format version");
+  }
+  const auto numNodes = reader.read<uint64_t>();
+  const auto numChildNodeIndices = reader.read<uint64_t>();
+  const auto numRootNodes = reader.read<uint64_t>();
+  const auto numErrors = reader.read<uint64_t>();
+  const auto numBounds = reader.read<uint64_t>();
+  const auto numGroupBounds = reader.read<uint64_t>();
+  const auto numClusters = reader.read<uint64_t>();
+  const auto numVertices = reader.read<uint64_t>();
+  const auto numTriangles = reader.read<uint64_t>();
+  const auto numMaterials = reader.read<uint64_t>();
+
+  const auto nodeClusterIndices = reader.readArray<uint64_t>(numNodes);
+  const auto nodeChildGroupIndices = reader.readArray<uint64_t>(numNodes);
+  const auto nodeChildCounts = reader.readArray<uint64_t>(numNodes);
+  const auto childNodeIndices = reader.readArray<uint64_t>(numChildNodeIndices);
+  const auto rootNodes = reader.readArray<uint64_t>(numRootNodes);
+
+  ClusterHierarchy hierarchy{};
+  hierarchy.nodes.resize(numNodes);
+  size_t childOffset = 0;
+  for (size_t i = 0; i < numNodes; ++i) {
+    if (nodeChildCounts[i] > childNodeIndices.size() - childOffset) {
+      throw std::runtime_error("invalid cluster hierarchy - child node indices out of range");
+    }
+    hierarchy.nodes[i].clusterIndex = nodeClusterIndices[i];
+    hierarchy.nodes[i].childGroupIndex = nodeChildGroupIndices[i];
+    hierarchy.nodes[i].childNodeIndices.assign(
+        childNodeIndices.cbegin() + static_cast<ptrdiff_t>(childOffset),
+        childNodeIndices.cbegin() + static_cast<ptrdiff_t>(childOffset + nodeChildCounts[i]));
+    childOffset += nodeChildCounts[i];
+  }
+  hierarchy.rootNodes.assign(rootNodes.cbegin(), rootNodes.cend());
+  hierarchy.errors = reader.readArray<NodeErrorBounds>(numErrors);
+  hierarchy.bounds = reader.readArray<ClusterBounds>(numBounds);
+  hierarchy.groupBounds = reader.readArray<GroupBounds>(numGroupBounds);
+  hierarchy.clusters = reader.readArray<Cluster>(numClusters);
+  hierarchy.vertices = reader.readArray<uint32_t>(numVertices);
+  hierarchy.triangles = reader.readArray<uint8_t>(numTriangles);
+  hierarchy.materials = reader.readArray<uint32_t>(numMaterials);
+  validateClusterHierarchy(hierarchy);
+  return std::move(hierarchy);
+}
+}  // namespace trichi
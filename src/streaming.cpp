@@ -0,0 +1,179 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+#include "impl.hpp"
+
+namespace trichi {
+StreamingLayout::StreamingLayout(const ClusterHierarchy& hierarchy, const StreamingParams& params) {
+  auto clusterGrouping = computeClusterUnits(hierarchy);
+  clusterUnits = std::move(clusterGrouping.clusterUnits);
+  const auto& unitLevels = clusterGrouping.unitLevels;
+
+  std::vector<size_t> unitSizes(unitLevels.size(), 0);
+  for (size_t i = 0; i < clusterUnits.size(); ++i) {
+    const auto& cluster = hierarchy.clusters[i];
+    unitSizes[clusterUnits[i]] += cluster.vertexCount * params.vertexSizeBytes + cluster.triangleCount * 3;
+  }
+
+  // units are packed into pages in the order of their first cluster, units larger than a page start a new page
+  const size_t pageSizeBytes = std::max(params.pageSizeBytes, static_cast<size_t>(1));
+  units.resize(unitSizes.size());
+  for (size_t unit = 0; unit < units.size(); ++unit) {
+    const size_t unitSize = unitSizes[unit];
+    if (pages.empty() || pages.back().sizeBytes + unitSize > pageSizeBytes) {
+      pages.emplace_back();
+    }
+    units[unit].firstPage = pages.size() - 1;
+    units[unit].pageCount = std::max((unitSize + pageSizeBytes - 1) / pageSizeBytes, static_cast<size_t>(1));
+    for (size_t page = 0; page < units[unit].pageCount; ++page) {
+      if (page > 0) {
+        pages.emplace_back();
+      }
+      pages.back().sizeBytes += std::min(unitSize - page * pageSizeBytes, pageSizeBytes);
+      pages.back().level = std::min(pages.back().level, unitLevels[unit]);
+    }
+  }
+}
+
+StreamingReport simulateStreaming(const ClusterHierarchy& hierarchy, const std::vector<ViewParams>& cameraPath, const StreamingParams& params) {
+  const StreamingLayout layout{hierarchy, params};
+  const auto& pages = layout.pages;
+  const auto bvh = buildClusterBvh(hierarchy);
+
+  StreamingReport report{};
+  report.numPages = pages.size();
+  for (const auto& page : pages) {
+    report.totalBytes += page.sizeBytes;
+  }
+
+  // frames are counted from 1, so that 0 means that a page has never been used
+  constexpr size_t kNever = 0;
+  std::vector<uint8_t> resident(pages.size(), 0);
+  std::vector<uint8_t> pinned(pages.size(), 0);
+  std::vector<size_t> lastUsed(pages.size(), kNever);
+  std::vector<size_t> streamedIn(pages.size(), kNever);
+  size_t residentBytes = 0;
+
+  // resident pages that may be evicted, ordered by the eviction policy
+  using EvictionKey = std::tuple<size_t, size_t, size_t>;
+  std::set<EvictionKey> evictionCandidates{};
+  const auto evictionKey = [&](const size_t page) -> EvictionKey {
+    switch (params.evictionPolicy) {
+      case EvictionPolicy::FirstInFirstOut:
+        return {streamedIn[page], 0, page};
+      case EvictionPolicy::FinestLevelFirst:
+        return {pages[page].level, lastUsed[page], page};
+      case EvictionPolicy::LeastRecentlyUsed:
+      default:
+        return {lastUsed[page], 0, page};
+    }
+  };
+
+  if (params.pinRootPages) {
+    for (const size_t rootNode : hierarchy.rootNodes) {
+      layout.forEachPage(hierarchy.nodes[rootNode].clusterIndex, [&](const size_t page) {
+        if (!pinned[page]) {
+          pinned[page] = 1;
+          resident[page] = 1;
+          residentBytes += pages[page].sizeBytes;
+        }
+      });
+    }
+    report.pinnedBytes = residentBytes;
+    if (residentBytes > params.poolSizeBytes) {
+      throw std::runtime_error("could not simulate streaming: pinned pages exceed the pool size");
+    }
+  }
+
+  std::vector<size_t> requiredPages{};
+  std::vector<size_t> faultedPages{};
+  for (size_t frameIndex = 0; frameIndex < cameraPath.size(); ++frameIndex) {
+    const size_t frame = frameIndex + 1;
+    StreamingFrameStatistics statistics{};
+
+    const auto selectedClusters = selectClusters(hierarchy, bvh, cameraPath[frameIndex]);
+    statistics.selectedClusters = selectedClusters.size();
+
+    requiredPages.clear();
+    for (const size_t clusterIndex : selectedClusters) {
+      bool isMissing = false;
+      layout.forEachPage(clusterIndex, [&](const size_t page) {
+        isMissing = isMissing || !resident[page];
+        if (lastUsed[page] != frame) {
+          if (resident[page] && !pinned[page]) {
+            evictionCandidates.erase(evictionKey(page));
+            lastUsed[page] = frame;
+            evictionCandidates.insert(evictionKey(page));
+          } else {
+            lastUsed[page] = frame;
+          }
+          requiredPages.emplace_back(page);
+        }
+      });
+      if (isMissing) {
+        ++statistics.missingClusters;
+      }
+    }
+    statistics.requiredPages = requiredPages.size();
+
+    faultedPages.clear();
+    for (const size_t page : requiredPages) {
+      statistics.workingSetBytes += pages[page].sizeBytes;
+      if (!resident[page]) {
+        faultedPages.emplace_back(page);
+      }
+    }
+    statistics.pageFaults = faultedPages.size();
+
+    // coarse pages are streamed in first, so that there are fallbacks for the more detailed ones if the budget is exceeded
+    std::sort(faultedPages.begin(), faultedPages.end(), [&](const size_t a, const size_t b) {
+      return pages[a].level != pages[b].level ? pages[a].level > pages[b].level : a < b;
+    });
+    for (const size_t page : faultedPages) {
+      const size_t pageSize = pages[page].sizeBytes;
+      // at least one page is streamed per frame, so that pages larger than the budget don't stall streaming forever
+      // smaller pages may still fit into the rest of the budget
+      if (params.maxBytesStreamedPerFrame != 0 && statistics.pagesStreamed != 0 && statistics.bytesStreamed + pageSize > params.maxBytesStreamedPerFrame) {
+        continue;
+      }
+      while (residentBytes + pageSize > params.poolSizeBytes) {
+        // pages required by the current frame are never evicted
+        const auto victim = std::find_if(evictionCandidates.begin(), evictionCandidates.end(), [&](const EvictionKey& key) {
+          return lastUsed[std::get<2>(key)] != frame;
+        });
+        if (victim == evictionCandidates.end()) {
+          break;
+        }
+        const size_t victimPage = std::get<2>(*victim);
+        evictionCandidates.erase(victim);
+        resident[victimPage] = 0;
+        residentBytes -= pages[victimPage].sizeBytes;
+        ++statistics.pagesEvicted;
+      }
+      if (residentBytes + pageSize > params.poolSizeBytes) {
+        continue;
+      }
+      resident[page] = 1;
+      streamedIn[page] = frame;
+      residentBytes += pageSize;
+      evictionCandidates.insert(evictionKey(page));
+      ++statistics.pagesStreamed;
+      statistics.bytesStreamed += pageSize;
+    }
+    statistics.residentBytes = residentBytes;
+
+    report.peakWorkingSetBytes = std::max(report.peakWorkingSetBytes, statistics.workingSetBytes);
+    report.totalPageFaults += statistics.pageFaults;
+    report.totalBytesStreamed += statistics.bytesStreamed;
+    report.frames.emplace_back(statistics);
+  }
+
+  return std::move(report);
+}
+}  // namespace trichi
@@ -19,7 +19,7 @@
 
 namespace trichi {
 [[nodiscard]] Buffers buildClusters(
-    const std::vector<uint32_t>& indices,
+    const std::span<const uint32_t> indices,
     const std::vector<float>& vertices,
     const size_t vertexCount,
     const size_t vertexStride,
@@ -48,6 +48,9 @@ namespace trichi {
       maxVertices,
       maxTriangles,
       coneWeight));
+  if (clusters.empty()) {
+    return {};
+  }
 
   // perf cost of this transform is insignificant
   std::transform(std::make_move_iterator(clusters.cbegin()), std::make_move_iterator(clusters.cend()), std::back_inserter(buffers.clusters), [](const auto& meshlet) {
@@ -66,6 +69,10 @@ namespace trichi {
   return std::move(buffers);
 }
 
+/**
+ * Builds the clusters of a simplified cluster group.
+ * Clusters are built in the given scratch buffers and only the used parts are copied to the returned buffers.
+ */
 [[nodiscard]] Buffers buildParentCeshlets(
     const std::vector<uint32_t>& indices,
     const std::vector<float>& vertices,
@@ -74,37 +81,186 @@ namespace trichi {
     const size_t maxVertices,
     const size_t maxTriangles,
     const float coneWeight,
-    const size_t maxClusters) {
-  auto buffers = buildClusters(indices, vertices, vertexCount, vertexStride, maxVertices, maxTriangles, coneWeight);
-
-  if (buffers.clusters.size() <= maxClusters) {
-    for (size_t i = 0; i < buffers.clusters.size(); ++i) {
-      const auto& meshlet = buffers.clusters[i];
-      meshopt_optimizeMeshlet(
-          &buffers.vertices[meshlet.vertexOffset],
-          &buffers.triangles[meshlet.triangleOffset],
-          meshlet.triangleCount,
-          meshlet.vertexCount);
+    ClusterScratch& scratch) {
+  const size_t maxClusters = meshopt_buildMeshletsBound(indices.size(), maxVertices, maxTriangles);
+  // each buffer's required size depends on different parameters, so they are grown independently
+  if (scratch.meshlets.size() < maxClusters) {
+    scratch.meshlets.resize(maxClusters);
+  }
+  if (scratch.vertices.size() < maxClusters * maxVertices) {
+    scratch.vertices.resize(maxClusters * maxVertices);
+  }
+  if (scratch.triangles.size() < maxClusters * maxTriangles * 3) {
+    scratch.triangles.resize(maxClusters * maxTriangles * 3);
+  }
+
+  const size_t numClusters = meshopt_buildMeshlets(
+      scratch.meshlets.data(),
+      scratch.vertices.data(),
+      scratch.triangles.data(),
+      indices.data(),
+      indices.size(),
+      vertices.data(),
+      vertexCount,
+      vertexStride,
+      maxVertices,
+      maxTriangles,
+      coneWeight);
+
+  Buffers buffers{};
+  if (numClusters == 0) {
+    return std::move(buffers);
+  }
+
+  buffers.clusters.reserve(numClusters);
+  std::transform(scratch.meshlets.cbegin(), scratch.meshlets.cbegin() + static_cast<ptrdiff_t>(numClusters), std::back_inserter(buffers.clusters), [](const auto& meshlet) {
+    return Cluster {
+      .vertexOffset = meshlet.vertex_offset,
+      .triangleOffset = meshlet.triangle_offset,
+      .vertexCount = meshlet.vertex_count,
+      .triangleCount = meshlet.triangle_count,
+    };
+  });
+
+  const auto& last = buffers.clusters.back();
+  buffers.vertices.assign(scratch.vertices.cbegin(), scratch.vertices.cbegin() + last.vertexOffset + last.vertexCount);
+  buffers.triangles.assign(scratch.triangles.cbegin(), scratch.triangles.cbegin() + last.triangleOffset + ((last.triangleCount * 3 + 3) & ~3));
+
+  return std::move(buffers);
+}
+
+void appendClusters(Buffers& buffers, Buffers&& clusters) {
+  for (auto& cluster : clusters.clusters) {
+    cluster.vertexOffset += buffers.vertices.size();
+    cluster.triangleOffset += buffers.triangles.size();
+  }
+  buffers.clusters.insert(
+      buffers.clusters.cend(),
+      std::make_move_iterator(clusters.clusters.cbegin()),
+      std::make_move_iterator(clusters.clusters.cend()));
+  buffers.vertices.insert(
+      buffers.vertices.cend(),
+      std::make_move_iterator(clusters.vertices.cbegin()),
+      std::make_move_iterator(clusters.vertices.cend()));
+  buffers.triangles.insert(
+      buffers.triangles.cend(),
+      std::make_move_iterator(clusters.triangles.cbegin()),
+      std::make_move_iterator(clusters.triangles.cend()));
+}
+
+/**
+ * The maximum number of triangles clustered at once when building the clusters of the input mesh.
+ * Larger meshes are clustered in chunks of consecutive triangles, so that builds can be aborted between chunks and chunks are clustered in parallel.
+ */
+constexpr size_t kMaxTrianglesPerClusteringChunk = size_t{1} << 18;
+
+/**
+ * Builds the clusters of the input mesh.
+ * Clusters never mix materials, so the triangles of all submeshes with the same material are clustered separately from other materials.
+ * The material of each cluster is written to `clusterMaterials`.
+ *
+ * @throws BuildAbortedError with an empty partial hierarchy if the build is aborted before all clusters were built.
+ */
+[[nodiscard]] Buffers buildMaterialClusters(
+    const std::vector<uint32_t>& indices,
+    const std::vector<Submesh>& submeshes,
+    const std::vector<float>& vertices,
+    const size_t vertexCount,
+    const size_t vertexStride,
+    const size_t maxVertices,
+    const size_t maxTriangles,
+    const float coneWeight,
+    std::vector<uint32_t>& clusterMaterials,
+    LoopRunner& loopRunner,
+    BuildMonitor& monitor) {
+  std::vector<uint32_t> materials{};
+  materials.reserve(submeshes.size());
+  for (const auto& submesh : submeshes) {
+    if (submesh.indexCount % 3 != 0 || submesh.firstIndex > indices.size() || submesh.indexCount > indices.size() - submesh.firstIndex) {
+      throw std::runtime_error("invalid submesh");
     }
+    materials.emplace_back(submesh.materialId);
+  }
+  std::sort(materials.begin(), materials.end());
+  materials.erase(std::unique(materials.begin(), materials.end()), materials.end());
+
+  // a single mesh is clustered in place, otherwise the indices of all submeshes with the same material are gathered first
+  std::vector<std::vector<uint32_t>> gatheredIndices(materials.size());
+  std::vector<std::span<const uint32_t>> materialIndices(materials.size());
+  if (submeshes.size() == 1 && submeshes[0].indexCount == indices.size()) {
+    materialIndices[0] = indices;
+  } else {
+    loopRunner.loop(0, materials.size(), [&](const size_t i) {
+      for (const auto& submesh : submeshes) {
+        if (monitor.shouldAbort()) {
+          return;
+        }
+        if (submesh.materialId == materials[i]) {
+          gatheredIndices[i].insert(
+              gatheredIndices[i].cend(),
+              indices.cbegin() + static_cast<ptrdiff_t>(submesh.firstIndex),
+              indices.cbegin() + static_cast<ptrdiff_t>(submesh.firstIndex + submesh.indexCount));
+        }
+      }
+      materialIndices[i] = gatheredIndices[i];
+    });
   }
 
+  // chunks are ordered by material, so the clusters of each material stay contiguous
+  std::vector<std::pair<uint32_t, std::span<const uint32_t>>> chunks{};
+  for (size_t i = 0; i < materials.size(); ++i) {
+    for (size_t first = 0; first < materialIndices[i].size(); first += 3 * kMaxTrianglesPerClusteringChunk) {
+      chunks.emplace_back(materials[i], materialIndices[i].subspan(first, std::min(3 * kMaxTrianglesPerClusteringChunk, materialIndices[i].size() - first)));
+    }
+  }
+
+  std::vector<Buffers> chunkClusters(chunks.size());
+  loopRunner.loop(0, chunks.size(), [&](const size_t i) {
+    if (!monitor.shouldAbort()) {
+      chunkClusters[i] = buildClusters(chunks[i].second, vertices, vertexCount, vertexStride, maxVertices, maxTriangles, coneWeight);
+    }
+  });
+  if (monitor.shouldAbort()) {
+    throw BuildAbortedError(monitor.reason(), {});
+  }
+
+  if (chunks.size() == 1) {
+    clusterMaterials.assign(chunkClusters[0].clusters.size(), chunks[0].first);
+    return std::move(chunkClusters[0]);
+  }
+  Buffers buffers{};
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    clusterMaterials.insert(clusterMaterials.cend(), chunkClusters[i].clusters.size(), chunks[i].first);
+    appendClusters(buffers, std::move(chunkClusters[i]));
+  }
   return std::move(buffers);
 }
 
-[[nodiscard]] std::vector<std::vector<size_t>> buildFinalClusterGroup(const size_t size) {
-  std::vector<std::vector<size_t>> groups{};
-  auto& group = groups.emplace_back(size);
+void optimizeClusters(Buffers& buffers, const size_t firstCluster, const size_t lastCluster) {
+  for (size_t i = firstCluster; i < lastCluster; ++i) {
+    const auto& cluster = buffers.clusters[i];
+    meshopt_optimizeMeshlet(
+        &buffers.vertices[cluster.vertexOffset],
+        &buffers.triangles[cluster.triangleOffset],
+        cluster.triangleCount,
+        cluster.vertexCount);
+  }
+}
+
+IndexGroups buildFinalClusterGroup(const size_t size) {
+  std::vector<uint32_t> group(size);
   std::iota(group.begin(), group.end(), 0);
+  IndexGroups groups{};
+  groups.append(group);
   return std::move(groups);
 }
 
 [[nodiscard]] std::vector<unsigned int>
-mergeGroup(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, const std::vector<size_t>& group, const size_t maxTriangles) {
+mergeGroup(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffers, const std::span<const uint32_t> group, const size_t maxTriangles) {
   std::vector<uint32_t> groupIndices{};
   groupIndices.reserve(3 * maxTriangles * group.size());
   for (const auto& groupClusterIndex : group) {
-    const auto& clusterIndex = clusterIndices[groupClusterIndex];
-    const auto& cluster = buffers.clusters[clusterIndex.index];
+    const auto& cluster = buffers.clusters[clusterIndices[groupClusterIndex]];
     if (cluster.triangleOffset + (cluster.triangleCount * 3) > buffers.triangles.size()) {
       throw std::runtime_error("fuck");
     }
@@ -119,6 +275,37 @@ mergeGroup(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffe
   return std::move(groupIndices);
 }
 
+/**
+ * Converts nodes from `buildClusterHierarchy`'s internal representation to `Node`s.
+ * Internally, nodes are implicitly given by their cluster index and store only the index of their group of child nodes.
+ * All parents created from the same cluster group share the same group of child nodes.
+ */
+[[nodiscard]] std::vector<Node> buildNodes(const std::vector<uint32_t>& nodeChildGroups, const IndexGroups& childGroups, const size_t firstNode) {
+  std::vector<Node> nodes(nodeChildGroups.size() - firstNode);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    nodes[i].clusterIndex = firstNode + i;
+    if (const uint32_t childGroup = nodeChildGroups[firstNode + i]; childGroup != kNoChildren) {
+      const auto children = childGroups[childGroup];
+      nodes[i].childNodeIndices.assign(children.begin(), children.end());
+      nodes[i].childGroupIndex = childGroup;
+    }
+  }
+  return std::move(nodes);
+}
+
+std::vector<float> packPositions(const std::vector<float>& vertices, const size_t vertexCount, const size_t vertexStride, LoopRunner& loopRunner) {
+  constexpr size_t kVerticesPerTask = 4096;
+  const size_t floatsPerVertex = vertexStride / sizeof(float);
+  std::vector<float> positions(vertexCount * 3);
+  loopRunner.loop(0, (vertexCount + kVerticesPerTask - 1) / kVerticesPerTask, [&](const size_t task) {
+    const size_t end = std::min((task + 1) * kVerticesPerTask, vertexCount);
+    for (size_t i = task * kVerticesPerTask; i < end; ++i) {
+      std::copy_n(&vertices[i * floatsPerVertex], 3, &positions[i * 3]);
+    }
+  });
+  return std::move(positions);
+}
+
 [[nodiscard]] std::pair<std::vector<unsigned int>, float> simplifyGroup(
     const std::vector<unsigned int>& groupIndices,
     const std::vector<float>& vertices,
@@ -145,7 +332,220 @@ mergeGroup(const std::vector<ClusterIndex>& clusterIndices, const Buffers& buffe
   return std::make_pair(std::move(simplifiedIndices), simplificationError);
 }
 
+/**
+ * Converts meshoptimizer's bounds of a cluster to `ClusterBounds`.
+ */
+[[nodiscard]] ClusterBounds toClusterBounds(const meshopt_Bounds& clusterBounds) {
+  ClusterBounds bounds{};
+  bounds.center[0] = clusterBounds.center[0];
+  bounds.center[1] = clusterBounds.center[1];
+  bounds.center[2] = clusterBounds.center[2];
+  bounds.radius = clusterBounds.radius;
+  bounds.normalCone.apex[0] = clusterBounds.cone_apex[0];
+  bounds.normalCone.apex[1] = clusterBounds.cone_apex[1];
+  bounds.normalCone.apex[2] = clusterBounds.cone_apex[2];
+  bounds.normalCone.axis[0] = clusterBounds.cone_axis[0];
+  bounds.normalCone.axis[1] = clusterBounds.cone_axis[1];
+  bounds.normalCone.axis[2] = clusterBounds.cone_axis[2];
+  bounds.normalCone.cutoff = clusterBounds.cone_cutoff;
+  return bounds;
+}
+
+void computeLeafClusterBounds(
+    const Buffers& buffers,
+    const size_t clusterIndex,
+    const std::vector<float>& vertices,
+    const size_t vertexCount,
+    const size_t vertexStride,
+    NodeErrorBounds& errorBounds,
+    ClusterBounds& bounds) {
+  const auto& cluster = buffers.clusters[clusterIndex];
+  const auto clusterBounds = meshopt_computeMeshletBounds(
+      &buffers.vertices[cluster.vertexOffset],
+      &buffers.triangles[cluster.triangleOffset],
+      cluster.triangleCount,
+      vertices.data(),
+      vertexCount,
+      vertexStride);
+
+  errorBounds.parentError.center[0] = clusterBounds.center[0];
+  errorBounds.parentError.center[1] = clusterBounds.center[1];
+  errorBounds.parentError.center[2] = clusterBounds.center[2];
+  errorBounds.parentError.radius = clusterBounds.radius;
+  errorBounds.parentError.error = std::numeric_limits<float>::max();
+  errorBounds.clusterError.center[0] = clusterBounds.center[0];
+  errorBounds.clusterError.center[1] = clusterBounds.center[1];
+  errorBounds.clusterError.center[2] = clusterBounds.center[2];
+  errorBounds.clusterError.radius = clusterBounds.radius;
+  errorBounds.clusterError.error = 0.0;
+
+  bounds = toClusterBounds(clusterBounds);
+}
+
+SimplifiedGroup simplifyClusterGroup(
+    const std::span<const uint32_t> group,
+    const std::vector<ClusterIndex>& clusterIndices,
+    const Buffers& buffers,
+    const std::vector<uint32_t>& clusterMaterials,
+    const std::vector<NodeErrorBounds>& nodeErrorBounds,
+    const std::vector<float>& vertices,
+    const size_t vertexCount,
+    const size_t vertexStride,
+    const Params& params) {
+  const size_t maxVertices = params.maxVerticesPerCluster;
+  const size_t maxTriangles = params.maxTrianglesPerCluster;
+  const size_t simplifyTargetIndexCount = std::min(maxVertices, maxTriangles) * 3 * 2;
+  constexpr float simplifyTargetError = std::numeric_limits<float>::max();
+
+  SimplifiedGroup result{};
+  if (group.size() <= 1) {
+    return std::move(result);
+  }
+
+  // clusters never mix materials, so the clusters of each material in a group are merged & simplified separately
+  // borders between materials are locked just like the group's border, so materials stay watertight
+  std::vector<uint32_t> materialGroups(group.begin(), group.end());
+  std::stable_sort(materialGroups.begin(), materialGroups.end(), [&](const uint32_t a, const uint32_t b) {
+    return clusterMaterials[clusterIndices[a]] < clusterMaterials[clusterIndices[b]];
+  });
+  size_t groupIndexCount = 0;
+  for (const uint32_t groupClusterIndex : group) {
+    groupIndexCount += buffers.clusters[clusterIndices[groupClusterIndex]].triangleCount * 3;
+  }
+  const auto correctedIndexCount = std::min(simplifyTargetIndexCount, groupIndexCount);
+
+  const size_t targetIndexCount =
+      group.size() <= 2 ? correctedIndexCount / 2 : correctedIndexCount;
+
+  std::vector<std::pair<uint32_t, std::vector<unsigned int>>> simplifiedMaterials{};
+  float simplificationError = 0.0f;
+  bool simplified = false;
+  for (size_t first = 0, last = 0; first < materialGroups.size(); first = last) {
+    const uint32_t material = clusterMaterials[clusterIndices[materialGroups[first]]];
+    last = first + 1;
+    while (last < materialGroups.size() && clusterMaterials[clusterIndices[materialGroups[last]]] == material) {
+      ++last;
+    }
+    const auto groupIndices = mergeGroup(clusterIndices, buffers, std::span(materialGroups).subspan(first, last - first), maxTriangles);
+
+    // each material gets its share of the target index count
+    const size_t materialTargetIndexCount = targetIndexCount * groupIndices.size() / groupIndexCount;
+    auto [simplifiedIndices, materialError] = simplifyGroup(
+        groupIndices, vertices, vertexCount, vertexStride, materialTargetIndexCount, simplifyTargetError);
+
+    simplified = simplified || simplifiedIndices.size() < groupIndices.size();
+    simplificationError = std::max(simplificationError, materialError);
+    simplifiedMaterials.emplace_back(material, std::move(simplifiedIndices));
+  }
+  if (!simplified) {
+    return std::move(result);
+  }
+
+  // scratch buffers are reused by all groups processed on the same thread
+  thread_local ClusterScratch scratch{};
+  Buffers groupClusters{};
+  std::vector<uint32_t> groupClusterMaterials{};
+  for (const auto& [material, simplifiedIndices] : simplifiedMaterials) {
+    auto materialClusters = buildParentCeshlets(
+        simplifiedIndices,
+        vertices,
+        vertexCount,
+        vertexStride,
+        maxVertices,
+        maxTriangles,
+        params.clusterConeWeight,
+        scratch);
+    groupClusterMaterials.insert(groupClusterMaterials.cend(), materialClusters.clusters.size(), material);
+    appendClusters(groupClusters, std::move(materialClusters));
+  }
+
+  if (groupClusters.clusters.empty() || groupClusters.clusters.size() >= group.size()) {
+    return std::move(result);
+  }
+
+  if (!params.deferClusterOptimization) {
+    optimizeClusters(groupClusters, 0, groupClusters.clusters.size());
+  }
+
+  // merge error bounds to conservatively bound all child groups
+  // the error bounds don't have to be a tight sphere around the group but must ensure monotonicity of the change in error from the root to its leaves
+  // see Federico Ponchio, "Multiresolution structures for interactive visualization of very large 3D datasets", Section 4.2.3
+  //
+  // we use the method from meshoptimizer's nanite demo
+  // https://github.com/zeux/meshoptimizer/blob/bfbbaddf38d6fc2311ba66762c6f7656a7c8dd79/demo/nanite.cpp#L67
+  float groupBoundsCenter[3] = {0.0, 0.0, 0.0};
+  float groupBoundsCenterWeight = 0.0;
+  for (const size_t groupClusterIndex : group) {
+    const auto& childError = nodeErrorBounds[clusterIndices[groupClusterIndex]].clusterError;
+    groupBoundsCenter[0] += childError.center[0] * childError.radius;
+    groupBoundsCenter[1] += childError.center[1] * childError.radius;
+    groupBoundsCenter[2] += childError.center[2] * childError.radius;
+    groupBoundsCenterWeight += childError.radius;
+  }
+  ErrorBounds groupErrorBounds{};
+  groupErrorBounds.center[0] = groupBoundsCenter[0] / groupBoundsCenterWeight;
+  groupErrorBounds.center[1] = groupBoundsCenter[1] / groupBoundsCenterWeight;
+  groupErrorBounds.center[2] = groupBoundsCenter[2] / groupBoundsCenterWeight;
+  groupErrorBounds.radius = 0.0;
+  groupErrorBounds.error = simplificationError;
+  for (const size_t groupClusterIndex : group) {
+    const auto& childError = nodeErrorBounds[clusterIndices[groupClusterIndex]].clusterError;
+    float dist[3] = {
+        groupErrorBounds.center[0] - childError.center[0],
+        groupErrorBounds.center[1] - childError.center[1],
+        groupErrorBounds.center[2] - childError.center[2],
+    };
+    groupErrorBounds.radius = std::max(groupErrorBounds.radius, childError.radius + std::sqrt(dist[0] * dist[0] + dist[1] * dist[1] + dist[2] * dist[2]));
+    groupErrorBounds.error = std::max(groupErrorBounds.error, childError.error);
+  }
+
+  // the children's parent error bounds are only updated when the level is merged, so an aborted level leaves no trace
+  result.groupErrorBounds = groupErrorBounds;
+  result.groupBounds = computeGroupBounds(clusterIndices, buffers, group, vertices, vertexStride);
+
+  for (size_t parentIndex = 0; parentIndex < groupClusters.clusters.size(); ++parentIndex) {
+    const auto& cluster = groupClusters.clusters[parentIndex];
+    const auto clusterBounds = meshopt_computeMeshletBounds(
+        &groupClusters.vertices[cluster.vertexOffset],
+        &groupClusters.triangles[cluster.triangleOffset],
+        cluster.triangleCount,
+        vertices.data(),
+        vertexCount,
+        vertexStride);
+
+    auto& nodeError = result.errorBounds.emplace_back();
+    nodeError.parentError.center[0] = groupErrorBounds.center[0];
+    nodeError.parentError.center[1] = groupErrorBounds.center[1];
+    nodeError.parentError.center[2] = groupErrorBounds.center[2];
+    nodeError.parentError.radius = std::numeric_limits<float>::max();
+    nodeError.parentError.error = std::numeric_limits<float>::max();
+    nodeError.clusterError = groupErrorBounds;
+
+    result.clusterBounds.emplace_back(toClusterBounds(clusterBounds));
+  }
+
+  result.clusters = std::move(groupClusters);
+  result.materials = std::move(groupClusterMaterials);
+  return std::move(result);
+}
+
 ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const Params& params) {
+  return buildClusterHierarchy(indices, vertices, vertexStride, params, LevelCallback{});
+}
+
+std::future<ClusterHierarchy> buildClusterHierarchyAsync(std::vector<uint32_t> indices, std::vector<float> vertices, const size_t vertexStride, Params params, LevelCallback onLevelCompleted) {
+  return std::async(
+      std::launch::async,
+      [indices = std::move(indices), vertices = std::move(vertices), vertexStride, params, onLevelCompleted = std::move(onLevelCompleted)]() {
+        return buildClusterHierarchy(indices, vertices, vertexStride, params, onLevelCompleted);
+      });
+}
+
+ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, const size_t vertexStride, const Params& params, const LevelCallback& onLevelCompleted) {
+  return buildClusterHierarchy(indices, {Submesh{.firstIndex = 0, .indexCount = indices.size(), .materialId = 0}}, vertices, vertexStride, params, onLevelCompleted);
+}
+
+ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<float>& vertices, const size_t vertexStride, const Params& params, const LevelCallback& onLevelCompleted) {
   // todo: remove
   const auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -158,68 +558,187 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
   const size_t maxTriangles = params.maxTrianglesPerCluster;
   const float coneWeight = params.clusterConeWeight;
   const size_t maxNumClustersPerGroup = params.targetClustersPerGroup;
-  const size_t simplifyTargetIndexCount = std::min(maxVertices, maxTriangles) * 3 * 2;
   const size_t maxLodCount = params.maxHierarchyDepth;
+  const bool deferOptimization = params.deferClusterOptimization;
 
   LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+  BuildMonitor monitor{params};
 
-  std::vector<size_t> lodOffsets = {0};
+  // all build stages only read positions, so wide vertices are packed once to keep them from pulling unused attributes into the cache
+  // indices are unchanged, so the hierarchy's vertex indices are valid for the input's vertices
+  const bool packedPositions = shouldPackPositions(vertexCount, vertexStride);
+  const std::vector<float> positionStream = packedPositions ? packPositions(vertices, vertexCount, vertexStride, loopRunner) : std::vector<float>{};
+  const std::vector<float>& positions = packedPositions ? positionStream : vertices;
+  const size_t positionStride = packedPositions ? 3 * sizeof(float) : vertexStride;
 
-  Buffers buffers = buildClusters(indices, vertices, vertexCount, vertexStride, maxVertices, maxTriangles, coneWeight);
+  // the material of each cluster, indexed by cluster index
+  std::vector<uint32_t> clusterMaterials{};
+
+  Buffers buffers = buildMaterialClusters(indices, submeshes, positions, vertexCount, positionStride, maxVertices, maxTriangles, coneWeight, clusterMaterials, loopRunner, monitor);
+  if (buffers.clusters.size() >= std::numeric_limits<uint32_t>::max() / 2) {
+    throw std::runtime_error("too many clusters");
+  }
+
+  // cluster metadata is stored as separate arrays, all indexed by cluster index
   std::vector<NodeErrorBounds> nodeErrorBounds(buffers.clusters.size());
   std::vector<ClusterBounds> nodeClusterBounds(buffers.clusters.size());
-  std::vector<Node> nodes(buffers.clusters.size());
+  std::vector<uint32_t> nodeChildGroups(buffers.clusters.size(), kNoChildren);
 
-  std::vector<ClusterIndex> clusterPool(buffers.clusters.size());
+  // the children of nodes created from the same cluster group & their tight bounds
+  IndexGroups childGroups{};
+  std::vector<GroupBounds> groupBounds{};
 
-  loopRunner.loop(0, clusterPool.size(), [&](const size_t i) {
-    const auto& cluster = buffers.clusters[i];
-    meshopt_optimizeMeshlet(
-        &buffers.vertices[cluster.vertexOffset],
-        &buffers.triangles[cluster.triangleOffset],
-        cluster.triangleCount,
-        cluster.vertexCount);
+  std::vector<ClusterIndex> clusterPool(buffers.clusters.size());
+  std::iota(clusterPool.begin(), clusterPool.end(), 0);
+
+  const auto estimateMemoryUsage = [&]() {
+    return buffers.clusters.size() * sizeof(Cluster) +
+           buffers.vertices.size() * sizeof(unsigned int) +
+           buffers.triangles.size() * sizeof(unsigned char) +
+           clusterMaterials.size() * sizeof(uint32_t) +
+           nodeChildGroups.size() * (sizeof(uint32_t) + sizeof(NodeErrorBounds) + sizeof(ClusterBounds)) +
+           (childGroups.offsets.size() + childGroups.indices.size()) * sizeof(uint32_t) +
+           groupBounds.size() * sizeof(GroupBounds) +
+           positionStream.size() * sizeof(float);
+  };
 
-    const auto clusterBounds = meshopt_computeMeshletBounds(
-        &buffers.vertices[cluster.vertexOffset],
-        &buffers.triangles[cluster.triangleOffset],
-        cluster.triangleCount,
-        vertices.data(),
-        vertexCount,
-        vertexStride);
+  // the clusters in the cluster pool are the roots of the hierarchy built so far
+  const auto assembleHierarchy = [&]() {
+    if (deferOptimization) {
+      loopRunner.loop(0, buffers.clusters.size(), [&buffers](const size_t i) {
+        optimizeClusters(buffers, i, i + 1);
+      });
+    }
 
-    nodeErrorBounds[i].parentError.center[0] = clusterBounds.center[0];
-    nodeErrorBounds[i].parentError.center[1] = clusterBounds.center[1];
-    nodeErrorBounds[i].parentError.center[2] = clusterBounds.center[2];
-    nodeErrorBounds[i].parentError.radius = clusterBounds.radius;
-    nodeErrorBounds[i].parentError.error = std::numeric_limits<float>::max();
-    nodeErrorBounds[i].clusterError.center[0] = clusterBounds.center[0];
-    nodeErrorBounds[i].clusterError.center[1] = clusterBounds.center[1];
-    nodeErrorBounds[i].clusterError.center[2] = clusterBounds.center[2];
-    nodeErrorBounds[i].clusterError.radius = clusterBounds.radius;
-    nodeErrorBounds[i].clusterError.error = 0.0;
-
-    nodeClusterBounds[i].center[0] = clusterBounds.center[0];
-    nodeClusterBounds[i].center[1] = clusterBounds.center[1];
-    nodeClusterBounds[i].center[2] = clusterBounds.center[2];
-    nodeClusterBounds[i].radius = clusterBounds.radius;
-    nodeClusterBounds[i].normalCone.apex[0] = clusterBounds.cone_apex[0];
-    nodeClusterBounds[i].normalCone.apex[1] = clusterBounds.cone_apex[1];
-    nodeClusterBounds[i].normalCone.apex[2] = clusterBounds.cone_apex[2];
-    nodeClusterBounds[i].normalCone.axis[0] = clusterBounds.cone_axis[0];
-    nodeClusterBounds[i].normalCone.axis[1] = clusterBounds.cone_axis[1];
-    nodeClusterBounds[i].normalCone.axis[2] = clusterBounds.cone_axis[2];
-
-    clusterPool[i] = ClusterIndex{
-        .index = i,
-        .lod = 0,
+    std::vector<size_t> rootNodes(clusterPool.cbegin(), clusterPool.cend());
+    std::sort(rootNodes.begin(), rootNodes.end());
+
+    return ClusterHierarchy{
+        .nodes = buildNodes(nodeChildGroups, childGroups, 0),
+        .rootNodes = std::move(rootNodes),
+        .errors = std::move(nodeErrorBounds),
+        .bounds = std::move(nodeClusterBounds),
+        .groupBounds = std::move(groupBounds),
+        .clusters = std::move(buffers.clusters),
+        .vertices = std::move(buffers.vertices),
+        .triangles = std::move(buffers.triangles),
+        .materials = std::move(clusterMaterials),
     };
+  };
+
+  // sorts all clusters starting at the given ones by their Morton codes and returns each cluster's new index relative to the first one
+  const auto sortLevelClusters = [&](const size_t firstNode, const size_t vertexOffset, const size_t triangleOffset) {
+    const auto order = computeMortonOrder(nodeClusterBounds, firstNode, loopRunner);
+    const size_t numClusters = order.size();
+
+    // vertex indices & triangles are rewritten in the new order as well, so that neighboring clusters are close in memory
+    // like meshoptimizer's, each cluster's triangles are padded to a multiple of 4 bytes
+    Buffers sorted{};
+    sorted.clusters.resize(numClusters);
+    size_t numVertices = 0;
+    size_t numTriangles = 0;
+    for (size_t i = 0; i < numClusters; ++i) {
+      auto& cluster = sorted.clusters[i];
+      cluster = buffers.clusters[firstNode + order[i]];
+      cluster.vertexOffset = static_cast<unsigned int>(vertexOffset + numVertices);
+      cluster.triangleOffset = static_cast<unsigned int>(triangleOffset + numTriangles);
+      numVertices += cluster.vertexCount;
+      numTriangles += (cluster.triangleCount * 3 + 3) & ~3;
+    }
+    sorted.vertices.resize(numVertices);
+    sorted.triangles.resize(numTriangles, 0);
+
+    std::vector<uint32_t> sortedMaterials(numClusters);
+    std::vector<NodeErrorBounds> sortedErrorBounds(numClusters);
+    std::vector<ClusterBounds> sortedClusterBounds(numClusters);
+    std::vector<uint32_t> sortedChildGroups(numClusters);
+    std::vector<uint32_t> newIndices(numClusters);
+    loopRunner.loop(0, numClusters, [&](const size_t i) {
+      const size_t source = firstNode + order[i];
+      const auto& sourceCluster = buffers.clusters[source];
+      const auto& cluster = sorted.clusters[i];
+      std::copy_n(
+          buffers.vertices.cbegin() + sourceCluster.vertexOffset,
+          cluster.vertexCount,
+          sorted.vertices.begin() + static_cast<ptrdiff_t>(cluster.vertexOffset - vertexOffset));
+      std::copy_n(
+          buffers.triangles.cbegin() + sourceCluster.triangleOffset,
+          cluster.triangleCount * 3,
+          sorted.triangles.begin() + static_cast<ptrdiff_t>(cluster.triangleOffset - triangleOffset));
+      sortedMaterials[i] = clusterMaterials[source];
+      sortedErrorBounds[i] = nodeErrorBounds[source];
+      sortedClusterBounds[i] = nodeClusterBounds[source];
+      sortedChildGroups[i] = nodeChildGroups[source];
+      newIndices[order[i]] = static_cast<uint32_t>(i);
+    });
 
-    nodes[i] = Node{
-        .clusterIndex = i,
+    std::move(sorted.clusters.begin(), sorted.clusters.end(), buffers.clusters.begin() + static_cast<ptrdiff_t>(firstNode));
+    buffers.vertices.resize(vertexOffset);
+    buffers.vertices.insert(buffers.vertices.cend(), sorted.vertices.cbegin(), sorted.vertices.cend());
+    buffers.triangles.resize(triangleOffset);
+    buffers.triangles.insert(buffers.triangles.cend(), sorted.triangles.cbegin(), sorted.triangles.cend());
+    std::copy(sortedMaterials.cbegin(), sortedMaterials.cend(), clusterMaterials.begin() + static_cast<ptrdiff_t>(firstNode));
+    std::copy(sortedErrorBounds.cbegin(), sortedErrorBounds.cend(), nodeErrorBounds.begin() + static_cast<ptrdiff_t>(firstNode));
+    std::copy(sortedClusterBounds.cbegin(), sortedClusterBounds.cend(), nodeClusterBounds.begin() + static_cast<ptrdiff_t>(firstNode));
+    std::copy(sortedChildGroups.cbegin(), sortedChildGroups.cend(), nodeChildGroups.begin() + static_cast<ptrdiff_t>(firstNode));
+    return newIndices;
+  };
+
+  // copies all clusters starting at the given ones to a level and publishes it
+  const auto publishLevel = [&](const size_t level, const size_t firstNode, const size_t firstGroup, const size_t vertexOffset, const size_t triangleOffset, std::vector<size_t> updatedNodes) {
+    std::vector<ErrorBounds> updatedParentErrors{};
+    updatedParentErrors.reserve(updatedNodes.size());
+    std::transform(updatedNodes.cbegin(), updatedNodes.cend(), std::back_inserter(updatedParentErrors), [&nodeErrorBounds](const size_t nodeIndex) {
+      return nodeErrorBounds[nodeIndex].parentError;
+    });
+    ClusterHierarchyLevel completedLevel{
+        .level = level,
+        .firstNode = firstNode,
+        .firstGroup = firstGroup,
+        .vertexOffset = vertexOffset,
+        .triangleOffset = triangleOffset,
+        .nodes = buildNodes(nodeChildGroups, childGroups, firstNode),
+        .errors = std::vector<NodeErrorBounds>(nodeErrorBounds.cbegin() + firstNode, nodeErrorBounds.cend()),
+        .bounds = std::vector<ClusterBounds>(nodeClusterBounds.cbegin() + firstNode, nodeClusterBounds.cend()),
+        .groupBounds = std::vector<GroupBounds>(groupBounds.cbegin() + firstGroup, groupBounds.cend()),
+        .clusters = std::vector<Cluster>(buffers.clusters.cbegin() + firstNode, buffers.clusters.cend()),
+        .vertices = std::vector<uint32_t>(buffers.vertices.cbegin() + vertexOffset, buffers.vertices.cend()),
+        .triangles = std::vector<uint8_t>(buffers.triangles.cbegin() + triangleOffset, buffers.triangles.cend()),
+        .materials = std::vector<uint32_t>(clusterMaterials.cbegin() + firstNode, clusterMaterials.cend()),
+        .updatedNodes = std::move(updatedNodes),
+        .updatedParentErrors = std::move(updatedParentErrors),
     };
+    // the build itself continues with the unoptimized clusters, so only the published copy is optimized
+    if (deferOptimization) {
+      loopRunner.loop(0, completedLevel.clusters.size(), [&completedLevel](const size_t i) {
+        const auto& cluster = completedLevel.clusters[i];
+        meshopt_optimizeMeshlet(
+            &completedLevel.vertices[cluster.vertexOffset - completedLevel.vertexOffset],
+            &completedLevel.triangles[cluster.triangleOffset - completedLevel.triangleOffset],
+            cluster.triangleCount,
+            cluster.vertexCount);
+      });
+    }
+    onLevelCompleted(completedLevel);
+  };
+
+  loopRunner.loop(0, clusterPool.size(), [&](const size_t i) {
+    if (!deferOptimization) {
+      optimizeClusters(buffers, i, i + 1);
+    }
+
+    computeLeafClusterBounds(buffers, i, positions, vertexCount, positionStride, nodeErrorBounds[i], nodeClusterBounds[i]);
   });
 
+  if (params.sortClustersSpatially) {
+    // the cluster pool contains all clusters in order, so it doesn't need to be remapped
+    sortLevelClusters(0, 0, 0);
+  }
+
+  if (onLevelCompleted) {
+    publishLevel(0, 0, 0, 0, 0, {});
+  }
+
   for (size_t level = 1; level < maxLodCount; ++level) {
     // todo: remove
     const auto lodStartTime = std::chrono::high_resolution_clock::now();
@@ -227,14 +746,19 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
     if (clusterPool.size() <= 1) {
       break;
     }
-    lodOffsets.emplace_back(buffers.clusters.size());
+
+    const size_t memoryUsage = estimateMemoryUsage();
+    if (monitor.shouldAbort(memoryUsage)) {
+      throw BuildAbortedError(monitor.reason(), assembleHierarchy());
+    }
 
     bool isLast = clusterPool.size() <= maxNumClustersPerGroup;
 
     const auto groups = isLast ? buildFinalClusterGroup(clusterPool.size())
-                               : groupClusters(clusterPool, buffers, maxNumClustersPerGroup, loopRunner);
+                               : groupClusters(clusterPool, buffers, nodeClusterBounds, maxNumClustersPerGroup, params.partitionRegions, params.seed, loopRunner);
 
-    constexpr float simplifyTargetError = std::numeric_limits<float>::max();
+    // memory used by this level's new clusters, so that the memory budget can be checked before the level is merged
+    std::atomic_size_t levelMemoryUsage = 0;
 
     std::atomic_size_t numNewMeshlets = 0;
     std::atomic_size_t numNewVertices = 0;
@@ -242,145 +766,45 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
     std::atomic_size_t numNextClusters = 0;
     std::atomic_size_t numNotSimplified = 0;
 
-    std::vector<Buffers> lodClusters(groups.size());
-    std::vector<std::vector<ClusterIndex>> lodClusterIndices(groups.size());
-    std::vector<std::vector<NodeErrorBounds>> lodErrorBounds(groups.size());
-    std::vector<std::vector<ClusterBounds>> lodClusterBounds(groups.size());
-    std::vector<std::vector<Node>> lodNodes(groups.size());
+    // per-group results - a group either produced new clusters (stored here) or its clusters are carried over to the next level
+    std::vector<SimplifiedGroup> lodGroups(groups.size());
 
-    // todo: cleanup
     loopRunner.loop(0, groups.size(), [&](const size_t i) {
-      const auto& group = groups[i];
-      if (group.empty()) {
+      const auto group = groups[i];
+      if (group.empty() || monitor.shouldAbort(memoryUsage + levelMemoryUsage)) {
         return;
       }
 
-      bool simplified = group.size() != 1;
-      if (simplified) {
-        const auto groupIndices = mergeGroup(clusterPool, buffers, group, maxTriangles);
-        const auto correctedIndexCount = std::min(simplifyTargetIndexCount, groupIndices.size());
-
-        const size_t targetIndexCount =
-            group.size() <= 2 ? correctedIndexCount / 2 : correctedIndexCount;
-        const auto [simplifiedIndices, simplificationError] = simplifyGroup(
-            groupIndices, vertices, vertexCount, vertexStride, targetIndexCount, simplifyTargetError);
-
-        simplified = simplifiedIndices.size() < groupIndices.size();
-        if (simplified) {
-          auto groupClusters = std::move(buildParentCeshlets(
-              simplifiedIndices,
-              vertices,
-              vertexCount,
-              vertexStride,
-              maxVertices,
-              maxTriangles,
-              coneWeight,
-              group.size() - 1));
-
-          simplified = groupClusters.clusters.size() < group.size();
-
-          if (simplified) {
-            numNewMeshlets += groupClusters.clusters.size();
-            numNewVertices += groupClusters.vertices.size();
-            numNewTriangles += groupClusters.triangles.size();
-            numNextClusters += groupClusters.clusters.size();
-
-            // merge error bounds to conservatively bound all child groups
-            // the error bounds don't have to be a tight sphere around the group but must ensure monotonicity of the change in error from the root to its leaves
-            // see Federico Ponchio, "Multiresolution structures for interactive visualization of very large 3D datasets", Section 4.2.3
-            //
-            // we use the method from meshoptimizer's nanite demo
-            // https://github.com/zeux/meshoptimizer/blob/bfbbaddf38d6fc2311ba66762c6f7656a7c8dd79/demo/nanite.cpp#L67
-            float groupBoundsCenter[3] = {0.0, 0.0, 0.0};
-            float groupBoundsCenterWeight = 0.0;
-            for (const size_t groupClusterIndex : group) {
-              const auto& childError = nodeErrorBounds[clusterPool[groupClusterIndex].index].clusterError;
-              groupBoundsCenter[0] += childError.center[0] * childError.radius;
-              groupBoundsCenter[1] += childError.center[1] * childError.radius;
-              groupBoundsCenter[2] += childError.center[2] * childError.radius;
-              groupBoundsCenterWeight += childError.radius;
-            }
-            ErrorBounds groupErrorBounds{};
-            groupErrorBounds.center[0] = groupBoundsCenter[0] / groupBoundsCenterWeight;
-            groupErrorBounds.center[1] = groupBoundsCenter[1] / groupBoundsCenterWeight;
-            groupErrorBounds.center[2] = groupBoundsCenter[2] / groupBoundsCenterWeight;
-            groupErrorBounds.radius = 0.0;
-            groupErrorBounds.error = simplificationError;
-            for (const size_t groupClusterIndex : group) {
-              const auto& childError = nodeErrorBounds[clusterPool[groupClusterIndex].index].clusterError;
-              float dist[3] = {
-                  groupErrorBounds.center[0] - childError.center[0],
-                  groupErrorBounds.center[1] - childError.center[1],
-                  groupErrorBounds.center[2] - childError.center[2],
-              };
-              groupErrorBounds.radius = std::max(groupErrorBounds.radius, childError.radius + std::sqrt(dist[0] * dist[0] + dist[1] * dist[1] + dist[2] * dist[2]));
-              groupErrorBounds.error = std::max(groupErrorBounds.error, childError.error);
-            }
-
-            std::vector<size_t> childNodeIndices{};
-            childNodeIndices.reserve(group.size());
-            for (const size_t groupClusterIndex : group) {
-              const size_t clusterIndex = clusterPool[groupClusterIndex].index;
-              nodeErrorBounds[clusterIndex].parentError = groupErrorBounds;
-              childNodeIndices.emplace_back(clusterIndex);
-            }
-
-            for (size_t parentIndex = 0; parentIndex < groupClusters.clusters.size(); ++parentIndex) {
-              const auto& cluster = groupClusters.clusters[parentIndex];
-              const auto clusterBounds = meshopt_computeMeshletBounds(
-                  &groupClusters.vertices[cluster.vertexOffset],
-                  &groupClusters.triangles[cluster.triangleOffset],
-                  cluster.triangleCount,
-                  vertices.data(),
-                  vertexCount,
-                  vertexStride);
-
-              auto& nodeError = lodErrorBounds[i].emplace_back();
-              nodeError.parentError.center[0] = groupErrorBounds.center[0];
-              nodeError.parentError.center[1] = groupErrorBounds.center[1];
-              nodeError.parentError.center[2] = groupErrorBounds.center[2];
-              nodeError.parentError.radius = std::numeric_limits<float>::max();
-              nodeError.parentError.error = std::numeric_limits<float>::max();
-              nodeError.clusterError = groupErrorBounds;
-
-              auto& nodeBounds = lodClusterBounds[i].emplace_back();
-              nodeBounds.center[0] = clusterBounds.center[0];
-              nodeBounds.center[1] = clusterBounds.center[1];
-              nodeBounds.center[2] = clusterBounds.center[2];
-              nodeBounds.radius = clusterBounds.radius;
-              nodeBounds.normalCone.apex[0] = clusterBounds.cone_apex[0];
-              nodeBounds.normalCone.apex[1] = clusterBounds.cone_apex[1];
-              nodeBounds.normalCone.apex[2] = clusterBounds.cone_apex[2];
-              nodeBounds.normalCone.axis[0] = clusterBounds.cone_axis[0];
-              nodeBounds.normalCone.axis[1] = clusterBounds.cone_axis[1];
-              nodeBounds.normalCone.axis[2] = clusterBounds.cone_axis[2];
-              nodeBounds.normalCone.cutoff = clusterBounds.cone_cutoff;
-
-              lodClusterIndices[i].emplace_back(ClusterIndex{
-                  .index = parentIndex,
-                  .lod = level,
-              });
-
-              lodNodes[i].emplace_back(Node{
-                  .clusterIndex = parentIndex,
-                  .childNodeIndices = childNodeIndices,
-              });
-            }
-
-            lodClusters[i] = std::move(groupClusters);
-          }
-        }
-      }
-      if (!simplified) {
+      auto simplifiedGroup = simplifyClusterGroup(group, clusterPool, buffers, clusterMaterials, nodeErrorBounds, positions, vertexCount, positionStride, params);
+      const auto& groupClusters = simplifiedGroup.clusters;
+      if (groupClusters.clusters.empty()) {
         numNotSimplified += group.size();
         numNextClusters += group.size();
-        std::transform(
-            group.cbegin(), group.cend(), std::back_inserter(lodClusterIndices[i]), [&clusterPool](const size_t clusterIndex) {
-              return clusterPool[clusterIndex];
-            });
+        return;
       }
+
+      numNewMeshlets += groupClusters.clusters.size();
+      numNewVertices += groupClusters.vertices.size();
+      numNewTriangles += groupClusters.triangles.size();
+      numNextClusters += groupClusters.clusters.size();
+      levelMemoryUsage +=
+          groupClusters.clusters.size() * (sizeof(Cluster) + 2 * sizeof(uint32_t) + sizeof(NodeErrorBounds) + sizeof(ClusterBounds)) +
+          (group.size() + 1) * sizeof(uint32_t) + sizeof(GroupBounds) +
+          groupClusters.vertices.size() * sizeof(unsigned int) +
+          groupClusters.triangles.size() * sizeof(unsigned char);
+      lodGroups[i] = std::move(simplifiedGroup);
     });
 
+    if (monitor.shouldAbort(memoryUsage + levelMemoryUsage)) {
+      throw BuildAbortedError(monitor.reason(), assembleHierarchy());
+    }
+
+    const size_t firstLevelNode = buffers.clusters.size();
+    const size_t firstLevelGroup = groupBounds.size();
+    const size_t firstLevelVertex = buffers.vertices.size();
+    const size_t firstLevelTriangle = buffers.triangles.size();
+    std::vector<size_t> updatedNodes{};
+
     std::vector<ClusterIndex> nextClusters{};
     // merge clusters & prepare next iteration's cluster_pool
     {
@@ -390,51 +814,47 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
       buffers.vertices.reserve(buffers.vertices.size() + numNewVertices);
       buffers.triangles.reserve(buffers.triangles.size() + numNewTriangles);
 
-      nodes.reserve(nodes.size() + numNewMeshlets);
+      nodeChildGroups.reserve(nodeChildGroups.size() + numNewMeshlets);
+      clusterMaterials.reserve(clusterMaterials.size() + numNewMeshlets);
 
       for (size_t i = 0; i < groups.size(); ++i) {
-        if (!lodClusters[i].clusters.empty()) {
-          for (size_t clusterIndex = 0; clusterIndex < lodClusterIndices[i].size(); ++clusterIndex) {
-            auto& cluster = lodClusterIndices[i][clusterIndex];
-            if (cluster.lod != level) {
-              continue;
-            }
-            cluster.index += buffers.clusters.size();
-
-            lodClusters[i].clusters[clusterIndex].vertexOffset += buffers.vertices.size();
-            lodClusters[i].clusters[clusterIndex].triangleOffset += buffers.triangles.size();
-
-            lodNodes[i][clusterIndex].clusterIndex += buffers.clusters.size();
+        const auto group = groups[i];
+        auto& lodGroup = lodGroups[i];
+        if (lodGroup.clusters.clusters.empty()) {
+          std::transform(group.begin(), group.end(), std::back_inserter(nextClusters), [&clusterPool](const uint32_t groupClusterIndex) {
+            return clusterPool[groupClusterIndex];
+          });
+          continue;
+        }
+
+        const auto childGroup = static_cast<uint32_t>(childGroups.size());
+        for (const uint32_t groupClusterIndex : group) {
+          const ClusterIndex childIndex = clusterPool[groupClusterIndex];
+          nodeErrorBounds[childIndex].parentError = lodGroup.groupErrorBounds;
+          childGroups.indices.emplace_back(childIndex);
+          if (onLevelCompleted) {
+            updatedNodes.emplace_back(childIndex);
           }
-          buffers.clusters.insert(
-              buffers.clusters.cend(),
-              std::make_move_iterator(lodClusters[i].clusters.cbegin()),
-              std::make_move_iterator(lodClusters[i].clusters.cend()));
-          buffers.vertices.insert(
-              buffers.vertices.cend(),
-              std::make_move_iterator(lodClusters[i].vertices.cbegin()),
-              std::make_move_iterator(lodClusters[i].vertices.cend()));
-          buffers.triangles.insert(
-              buffers.triangles.cend(),
-              std::make_move_iterator(lodClusters[i].triangles.cbegin()),
-              std::make_move_iterator(lodClusters[i].triangles.cend()));
-          nodeErrorBounds.insert(
-              nodeErrorBounds.cend(),
-              std::make_move_iterator(lodErrorBounds[i].cbegin()),
-              std::make_move_iterator(lodErrorBounds[i].cend()));
-          nodeClusterBounds.insert(
-              nodeClusterBounds.cend(),
-              std::make_move_iterator(lodClusterBounds[i].cbegin()),
-              std::make_move_iterator(lodClusterBounds[i].cend()));
-          nodes.insert(
-              nodes.cend(),
-              std::make_move_iterator(lodNodes[i].cbegin()),
-              std::make_move_iterator(lodNodes[i].cend()));
         }
-        nextClusters.insert(
-            nextClusters.cend(),
-            std::make_move_iterator(lodClusterIndices[i].cbegin()),
-            std::make_move_iterator(lodClusterIndices[i].cend()));
+        childGroups.offsets.emplace_back(static_cast<uint32_t>(childGroups.indices.size()));
+        groupBounds.emplace_back(lodGroup.groupBounds);
+
+        const size_t numGroupClusters = lodGroup.clusters.clusters.size();
+        for (size_t parentIndex = 0; parentIndex < numGroupClusters; ++parentIndex) {
+          nextClusters.emplace_back(static_cast<ClusterIndex>(buffers.clusters.size() + parentIndex));
+        }
+        nodeChildGroups.insert(nodeChildGroups.cend(), numGroupClusters, childGroup);
+
+        appendClusters(buffers, std::move(lodGroup.clusters));
+        clusterMaterials.insert(clusterMaterials.cend(), lodGroup.materials.cbegin(), lodGroup.materials.cend());
+        nodeErrorBounds.insert(
+            nodeErrorBounds.cend(),
+            std::make_move_iterator(lodGroup.errorBounds.cbegin()),
+            std::make_move_iterator(lodGroup.errorBounds.cend()));
+        nodeClusterBounds.insert(
+            nodeClusterBounds.cend(),
+            std::make_move_iterator(lodGroup.clusterBounds.cbegin()),
+            std::make_move_iterator(lodGroup.clusterBounds.cend()));
       }
 
       // todo: remove
@@ -459,13 +879,22 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
       break;
     }
 
-    clusterPool = std::move(nextClusters);
-  }
+    if (params.sortClustersSpatially) {
+      const auto newIndices = sortLevelClusters(firstLevelNode, firstLevelVertex, firstLevelTriangle);
+      for (auto& clusterIndex : nextClusters) {
+        if (clusterIndex >= firstLevelNode) {
+          clusterIndex = static_cast<ClusterIndex>(firstLevelNode + newIndices[clusterIndex - firstLevelNode]);
+        }
+      }
+      // the next level visits its clusters in memory order
+      std::sort(nextClusters.begin(), nextClusters.end());
+    }
+
+    if (onLevelCompleted) {
+      publishLevel(level, firstLevelNode, firstLevelGroup, firstLevelVertex, firstLevelTriangle, std::move(updatedNodes));
+    }
 
-  size_t numRootNodes = buffers.clusters.size() - lodOffsets.back();
-  std::vector<size_t> rootNodes{};
-  for (size_t i = numRootNodes; i < buffers.clusters.size(); ++i) {
-    rootNodes.emplace_back(i);
+    clusterPool = std::move(nextClusters);
   }
 
   // todo: remove
@@ -474,15 +903,7 @@ ClusterHierarchy buildClusterHierarchy(const std::vector<uint32_t>& indices, con
       "create dag: took %ld ms\n",
       std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
 
-  return ClusterHierarchy{
-      .nodes = std::move(nodes),
-      .rootNodes = std::move(rootNodes),
-      .errors = std::move(nodeErrorBounds),
-      .bounds = std::move(nodeClusterBounds),
-      .clusters = std::move(buffers.clusters),
-      .vertices = std::move(buffers.vertices),
-      .triangles = std::move(buffers.triangles),
-  };
+  return assembleHierarchy();
 }
 
 }  // namespace trichi
@@ -0,0 +1,265 @@
+/**
+* Copyright (c) 2024 Lukas Herzberger
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "impl.hpp"
+
+namespace trichi {
+/**
+ * Empties a cluster without changing its index, so that the indices of all other clusters stay valid.
+ * The cluster has no triangles & no children, and its error is infinite, so it is never selected.
+ */
+void discardCluster(ClusterHierarchy& hierarchy, Buffers& buffers, const size_t clusterIndex) {
+  buffers.clusters[clusterIndex].vertexCount = 0;
+  buffers.clusters[clusterIndex].triangleCount = 0;
+  hierarchy.nodes[clusterIndex].childNodeIndices.clear();
+  hierarchy.nodes[clusterIndex].childGroupIndex = kNoChildren;
+  auto& errors = hierarchy.errors[clusterIndex];
+  errors.clusterError.radius = 0.0;
+  errors.clusterError.error = std::numeric_limits<float>::max();
+  errors.parentError.radius = 0.0;
+  errors.parentError.error = std::numeric_limits<float>::max();
+  hierarchy.bounds[clusterIndex].radius = 0.0;
+}
+
+std::vector<ClusterIndex> extendClusterHierarchy(
+    ClusterHierarchy& hierarchy,
+    Buffers& buffers,
+    const std::vector<std::vector<ClusterIndex>>& levelClusters,
+    const std::vector<float>& vertices,
+    const size_t vertexCount,
+    const size_t vertexStride,
+    const Params& params,
+    LoopRunner& loopRunner) {
+  const size_t maxNumClustersPerGroup = params.targetClustersPerGroup;
+  const size_t maxLodCount = params.maxHierarchyDepth;
+
+  const size_t firstNewCluster = buffers.clusters.size();
+  std::vector<ClusterIndex> clusterPool{};
+  size_t nextLevel = 0;
+  for (size_t level = 1; level < maxLodCount; ++level) {
+    if (nextLevel < levelClusters.size()) {
+      clusterPool.insert(clusterPool.cend(), levelClusters[nextLevel].cbegin(), levelClusters[nextLevel].cend());
+      ++nextLevel;
+    }
+    const bool hasMoreClusters = nextLevel < levelClusters.size();
+    if (clusterPool.size() <= 1) {
+      if (!hasMoreClusters) {
+        break;
+      }
+      continue;
+    }
+
+    const auto groups = clusterPool.size() <= maxNumClustersPerGroup
+        ? buildFinalClusterGroup(clusterPool.size())
+        : groupClusters(clusterPool, buffers, hierarchy.bounds, maxNumClustersPerGroup, params.partitionRegions, params.seed, loopRunner);
+
+    std::vector<SimplifiedGroup> levelGroups(groups.size());
+    loopRunner.loop(0, groups.size(), [&](const size_t i) {
+      if (!groups[i].empty()) {
+        levelGroups[i] = simplifyClusterGroup(groups[i], clusterPool, buffers, hierarchy.materials, hierarchy.errors, vertices, vertexCount, vertexStride, params);
+      }
+    });
+
+    std::vector<ClusterIndex> nextClusters{};
+    size_t numNewClusters = 0;
+    for (size_t i = 0; i < groups.size(); ++i) {
+      const auto group = groups[i];
+      auto& levelGroup = levelGroups[i];
+      if (levelGroup.clusters.clusters.empty()) {
+        std::transform(group.begin(), group.end(), std::back_inserter(nextClusters), [&clusterPool](const uint32_t groupClusterIndex) {
+          return clusterPool[groupClusterIndex];
+        });
+        continue;
+      }
+
+      const size_t childGroup = hierarchy.groupBounds.size();
+      std::vector<size_t> children{};
+      children.reserve(group.size());
+      for (const uint32_t groupClusterIndex : group) {
+        const ClusterIndex childIndex = clusterPool[groupClusterIndex];
+        hierarchy.errors[childIndex].parentError = levelGroup.groupErrorBounds;
+        children.emplace_back(childIndex);
+      }
+      hierarchy.groupBounds.emplace_back(levelGroup.groupBounds);
+
+      const size_t numGroupClusters = levelGroup.clusters.clusters.size();
+      for (size_t parentIndex = 0; parentIndex < numGroupClusters; ++parentIndex) {
+        const size_t clusterIndex = buffers.clusters.size() + parentIndex;
+        nextClusters.emplace_back(static_cast<ClusterIndex>(clusterIndex));
+        hierarchy.nodes.emplace_back(Node{
+            .clusterIndex = clusterIndex,
+            .childNodeIndices = children,
+            .childGroupIndex = childGroup,
+        });
+      }
+      numNewClusters += numGroupClusters;
+
+      appendClusters(buffers, std::move(levelGroup.clusters));
+      hierarchy.materials.insert(hierarchy.materials.cend(), levelGroup.materials.cbegin(), levelGroup.materials.cend());
+      hierarchy.errors.insert(hierarchy.errors.cend(), levelGroup.errorBounds.cbegin(), levelGroup.errorBounds.cend());
+      hierarchy.bounds.insert(hierarchy.bounds.cend(), levelGroup.clusterBounds.cbegin(), levelGroup.clusterBounds.cend());
+    }
+    if (buffers.clusters.size() >= std::numeric_limits<uint32_t>::max() / 2) {
+      throw std::runtime_error("too many clusters");
+    }
+
+    clusterPool = std::move(nextClusters);
+    if (numNewClusters == 0 && !hasMoreClusters) {
+      break;
+    }
+  }
+  for (; nextLevel < levelClusters.size(); ++nextLevel) {
+    clusterPool.insert(clusterPool.cend(), levelClusters[nextLevel].cbegin(), levelClusters[nextLevel].cend());
+  }
+
+  if (params.deferClusterOptimization) {
+    loopRunner.loop(firstNewCluster, buffers.clusters.size(), [&buffers](const size_t i) {
+      optimizeClusters(buffers, i, i + 1);
+    });
+  }
+  return std::move(clusterPool);
+}
+
+ClusterHierarchy updateClusterHierarchy(ClusterHierarchy hierarchy, const std::vector<float>& vertices, const size_t vertexStride, const std::vector<uint32_t>& changedVertices, const Params& params) {
+  if ((vertices.size() * sizeof(float)) % vertexStride != 0) {
+    throw std::runtime_error("invalid vertex stride");
+  }
+  const size_t vertexCount = (vertices.size() * sizeof(float)) / vertexStride;
+
+  const size_t numClusters = hierarchy.clusters.size();
+  if (hierarchy.nodes.size() != numClusters || hierarchy.errors.size() != numClusters || hierarchy.bounds.size() != numClusters) {
+    throw std::runtime_error("could not update hierarchy: number of nodes, clusters and errors differ");
+  }
+  if (hierarchy.materials.size() != numClusters) {
+    hierarchy.materials.assign(numClusters, 0);
+  }
+  if (!hierarchy.vertices.empty() && *std::max_element(hierarchy.vertices.cbegin(), hierarchy.vertices.cend()) >= vertexCount) {
+    throw std::runtime_error("could not update hierarchy: index out of range");
+  }
+
+  std::vector<uint8_t> isChanged(vertexCount, 0);
+  for (const uint32_t vertexIndex : changedVertices) {
+    if (vertexIndex >= vertexCount) {
+      throw std::runtime_error("could not update hierarchy: changed vertex out of range");
+    }
+    isChanged[vertexIndex] = 1;
+  }
+
+  LoopRunner loopRunner{std::max(params.threadPoolSize, static_cast<size_t>(1))};
+
+  const bool packedPositions = shouldPackPositions(vertexCount, vertexStride);
+  const std::vector<float> positionStream = packedPositions ? packPositions(vertices, vertexCount, vertexStride, loopRunner) : std::vector<float>{};
+  const std::vector<float>& positions = packedPositions ? positionStream : vertices;
+  const size_t positionStride = packedPositions ? 3 * sizeof(float) : vertexStride;
+
+  Buffers buffers{
+      .clusters = std::move(hierarchy.clusters),
+      .vertices = std::move(hierarchy.vertices),
+      .triangles = std::move(hierarchy.triangles),
+  };
+
+  // clusters without children that use a changed vertex are affected, and so are all of their ancestors
+  // a node's children always come before the node itself in the hierarchy
+  std::vector<uint8_t> isAffected(numClusters, 0);
+  loopRunner.loop(0, numClusters, [&](const size_t i) {
+    const auto& cluster = buffers.clusters[i];
+    if (hierarchy.nodes[i].childNodeIndices.empty()) {
+      isAffected[i] = std::any_of(
+          buffers.vertices.cbegin() + cluster.vertexOffset,
+          buffers.vertices.cbegin() + cluster.vertexOffset + cluster.vertexCount,
+          [&isChanged](const unsigned int vertexIndex) { return isChanged[vertexIndex] != 0; }) ? 1 : 0;
+    }
+  });
+  for (size_t i = 0; i < numClusters; ++i) {
+    const auto& children = hierarchy.nodes[i].childNodeIndices;
+    if (std::any_of(children.cbegin(), children.cend(), [&isAffected](const size_t child) { return isAffected[child] != 0; })) {
+      isAffected[i] = 1;
+    }
+  }
+
+  // affected clusters without children keep their triangles, all other affected clusters are rebuilt
+  // the children of rebuilt clusters are regrouped on the level they were built on
+  const auto levels = computeNodeLevels(hierarchy);
+  std::vector<std::vector<ClusterIndex>> levelOrphans{};
+  std::vector<uint8_t> isOrphaned(numClusters, 0);
+  for (size_t i = 0; i < numClusters; ++i) {
+    if (!isAffected[i]) {
+      continue;
+    }
+    for (const size_t child : hierarchy.nodes[i].childNodeIndices) {
+      isOrphaned[child] = 1;
+    }
+    if (hierarchy.nodes[i].childNodeIndices.empty()) {
+      isOrphaned[i] = 1;
+    }
+  }
+  for (size_t i = 0; i < numClusters; ++i) {
+    if (isOrphaned[i] && !(isAffected[i] && !hierarchy.nodes[i].childNodeIndices.empty())) {
+      if (levels[i] >= levelOrphans.size()) {
+        levelOrphans.resize(levels[i] + 1);
+      }
+      levelOrphans[levels[i]].emplace_back(static_cast<ClusterIndex>(i));
+      hierarchy.errors[i].parentError.error = std::numeric_limits<float>::max();
+    }
+  }
+  for (size_t i = 0; i < numClusters; ++i) {
+    if (isAffected[i] && !hierarchy.nodes[i].childNodeIndices.empty()) {
+      discardCluster(hierarchy, buffers, i);
+    }
+  }
+  loopRunner.loop(0, numClusters, [&](const size_t i) {
+    if (isAffected[i] && hierarchy.nodes[i].childNodeIndices.empty() && buffers.clusters[i].triangleCount != 0) {
+      computeLeafClusterBounds(buffers, i, positions, vertexCount, positionStride, hierarchy.errors[i], hierarchy.bounds[i]);
+    }
+  });
+
+  const auto clusterPool = extendClusterHierarchy(hierarchy, buffers, levelOrphans, positions, vertexCount, positionStride, params, loopRunner);
+
+  // untouched roots stay roots, the remaining clusters of the rebuilt part are new roots
+  std::vector<size_t> rootNodes{};
+  std::copy_if(hierarchy.rootNodes.cbegin(), hierarchy.rootNodes.cend(), std::back_inserter(rootNodes), [&isAffected](const size_t rootNode) {
+    return !isAffected[rootNode];
+  });
+  rootNodes.insert(rootNodes.cend(), clusterPool.cbegin(), clusterPool.cend());
+  std::sort(rootNodes.begin(), rootNodes.end());
+  hierarchy.rootNodes = std::move(rootNodes);
+
+  // the data of discarded clusters is left in place, so that the offsets of all other clusters stay valid
+  hierarchy.clusters = std::move(buffers.clusters);
+  hierarchy.vertices = std::move(buffers.vertices);
+  hierarchy.triangles = std::move(buffers.triangles);
+  return hierarchy;
+}
+
+ClusterHierarchy compactClusterHierarchy(ClusterHierarchy hierarchy) {
+  // like meshoptimizer's, each cluster's triangles are padded to a multiple of 4 bytes
+  std::vector<Cluster> clusters(hierarchy.clusters.size());
+  size_t numVertices = 0;
+  size_t numTriangles = 0;
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    clusters[i] = hierarchy.clusters[i];
+    clusters[i].vertexOffset = static_cast<unsigned int>(numVertices);
+    clusters[i].triangleOffset = static_cast<unsigned int>(numTriangles);
+    numVertices += clusters[i].vertexCount;
+    numTriangles += (clusters[i].triangleCount * 3 + 3) & ~3;
+  }
+
+  std::vector<unsigned int> vertices(numVertices);
+  std::vector<unsigned char> triangles(numTriangles, 0);
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    const auto& source = hierarchy.clusters[i];
+    std::copy_n(hierarchy.vertices.cbegin() + source.vertexOffset, source.vertexCount, vertices.begin() + clusters[i].vertexOffset);
+    std::copy_n(hierarchy.triangles.cbegin() + source.triangleOffset, source.triangleCount * 3, triangles.begin() + clusters[i].triangleOffset);
+  }
+
+  hierarchy.clusters = std::move(clusters);
+  hierarchy.vertices = std::move(vertices);
+  hierarchy.triangles = std::move(triangles);
+  return hierarchy;
+}
+}  // namespace trichi
@@ -6,7 +6,7 @@
 #ifndef TRICHI_UTIL_HPP
 #define TRICHI_UTIL_HPP
 
-#include <algorithm>          // std::set_intersection
+#include <algorithm>          // std::min
 #include <cstdint>            // uint64_t
 
 #ifdef TRICHI_PARALLEL
@@ -42,25 +42,6 @@ class LoopRunner {
   BS::thread_pool threadPool;
 #endif //TRICHI_PARALLEL
 };
-
-// https://stackoverflow.com/questions/32640327/how-to-compute-the-size-of-an-intersection-of-two-stl-sets-in-c
-struct Counter {
-  struct value_type {
-    template <typename T>
-    value_type(const T&) {}
-  };
-
-  void push_back(const value_type&) { ++count; }
-
-  size_t count = 0;
-};
-
-template <typename T1, typename T2>
-size_t intersectionSize(const T1& s1, const T2& s2) {
-  Counter c{};
-  std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(c));
-  return c.count;
-}
 }  // namespace trichi
 
 #endif  //TRICHI_UTIL_HPP
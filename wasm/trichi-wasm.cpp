@@ -1,3 +1,4 @@
+#include <atomic>
 #include <iostream>
 
 #include <emscripten/bind.h>
@@ -49,6 +50,11 @@
     triangles.set(i, hierarchy.triangles[i]);
   }
 
+  auto materials = emscripten::val::global("Uint32Array").new_(hierarchy.materials.size());
+  for (size_t i = 0; i < hierarchy.materials.size(); ++i) {
+    materials.set(i, hierarchy.materials[i]);
+  }
+
   // todo: nodes & root nodes
 
   emscripten::val result = emscripten::val::object();
@@ -57,18 +63,81 @@
   result.set("clusters", clusters);
   result.set("clusterVertices", vertices);
   result.set("clusterTriangles", triangles);
+  result.set("clusterMaterials", materials);
 
   return result;
 }
 
+/**
+ * Set to cancel the running build, or the next one if no build is running.
+ * The token is reset whenever a build returns.
+ * Builds run synchronously on the calling thread, so the token is set by another thread through the module's shared memory (see `getCancellationToken`).
+ */
+std::atomic_bool cancellationToken = false;
+static_assert(sizeof(std::atomic_bool) == 1 && std::atomic_bool::is_always_lock_free, "the cancellation token is set with Atomics.store on a Uint8Array");
+
+/**
+ * Returns a Uint8Array view on the cancellation token.
+ * If the module is built with multithreading, the view's buffer is a SharedArrayBuffer that can be sent to other threads.
+ */
+[[nodiscard]] emscripten::val getCancellationToken() {
+  return emscripten::val(emscripten::typed_memory_view(1, reinterpret_cast<uint8_t*>(&cancellationToken)));
+}
+
+/**
+ * Builds a cluster hierarchy and converts it to a JS object.
+ * If the build is aborted, the partial hierarchy is returned and its `aborted` property is set to true.
+ */
+[[nodiscard]] emscripten::val buildAndConvertClusterHierarchy(const std::vector<uint32_t>& indices, const std::vector<trichi::Submesh>& submeshes, const std::vector<float>& vertices, const size_t vertexStride, const trichi::Params& params) {
+  trichi::Params cancellableParams = params;
+  cancellableParams.cancellationToken = &cancellationToken;
+  try {
+    auto hierarchy = convertToJsObjec(trichi::buildClusterHierarchy(indices, submeshes, vertices, vertexStride, cancellableParams), true);
+    cancellationToken = false;
+    hierarchy.set("aborted", false);
+    return hierarchy;
+  } catch (const trichi::BuildAbortedError& e) {
+    // a cancellation only applies to a single build
+    cancellationToken = false;
+    std::cout << e.what() << "\n";
+    auto hierarchy = convertToJsObjec(e.partialHierarchy(), true);
+    hierarchy.set("aborted", true);
+    return hierarchy;
+  }
+}
+
 [[nodiscard]] emscripten::val buildTriangleClusterHierarchy(const emscripten::val& indicesJs, const emscripten::val& verticesJs, const size_t vertexStride, const trichi::Params& params) {
-  auto hierarchy = convertToJsObjec(
-      trichi::buildClusterHierarchy(
-        emscripten::convertJSArrayToNumberVector<uint32_t>(indicesJs),
-        emscripten::convertJSArrayToNumberVector<float>(verticesJs),
-        vertexStride,
-        params),
-      true);
+  const auto indices = emscripten::convertJSArrayToNumberVector<uint32_t>(indicesJs);
+  auto hierarchy = buildAndConvertClusterHierarchy(
+      indices,
+      {trichi::Submesh{.firstIndex = 0, .indexCount = indices.size(), .materialId = 0}},
+      emscripten::convertJSArrayToNumberVector<float>(verticesJs),
+      vertexStride,
+      params);
+  hierarchy.set("indices", indicesJs);
+  hierarchy.set("vertices", verticesJs);
+  hierarchy.set("vertexStrideFloats", vertexStride / sizeof(float));
+  return hierarchy;
+}
+
+/**
+ * Builds a cluster hierarchy for a mesh with multiple submeshes.
+ * Submeshes are given as triplets of first index, index count, and material id.
+ */
+[[nodiscard]] emscripten::val buildMultiMaterialTriangleClusterHierarchy(const emscripten::val& indicesJs, const emscripten::val& submeshesJs, const emscripten::val& verticesJs, const size_t vertexStride, const trichi::Params& params) {
+  const auto submeshTriplets = emscripten::convertJSArrayToNumberVector<uint32_t>(submeshesJs);
+  std::vector<trichi::Submesh> submeshes(submeshTriplets.size() / 3);
+  for (size_t i = 0; i < submeshes.size(); ++i) {
+    submeshes[i].firstIndex = submeshTriplets[i * 3 + 0];
+    submeshes[i].indexCount = submeshTriplets[i * 3 + 1];
+    submeshes[i].materialId = submeshTriplets[i * 3 + 2];
+  }
+  auto hierarchy = buildAndConvertClusterHierarchy(
+      emscripten::convertJSArrayToNumberVector<uint32_t>(indicesJs),
+      submeshes,
+      emscripten::convertJSArrayToNumberVector<float>(verticesJs),
+      vertexStride,
+      params);
   hierarchy.set("indices", indicesJs);
   hierarchy.set("vertices", verticesJs);
   hierarchy.set("vertexStrideFloats", vertexStride / sizeof(float));
@@ -80,6 +149,7 @@
   const size_t vertexStride = floatsPerVertex * sizeof(float);
   std::vector<float> vertices{};
   std::vector<uint32_t> indices{};
+  std::vector<trichi::Submesh> submeshes{};
   {
     const auto bytes = emscripten::convertJSArrayToNumberVector<uint8_t>(bytesJs);
 
@@ -96,26 +166,40 @@
             aiProcess_SortByPType,
         fileName.c_str());
 
-    for (int i = 0; i < scene->mMeshes[0]->mNumVertices; ++i) {
-      vertices.push_back(scene->mMeshes[0]->mVertices[i].x);
-      vertices.push_back(scene->mMeshes[0]->mVertices[i].y);
-      vertices.push_back(scene->mMeshes[0]->mVertices[i].z);
-      vertices.push_back(scene->mMeshes[0]->mNormals[i].x);
-      vertices.push_back(scene->mMeshes[0]->mNormals[i].y);
-      vertices.push_back(scene->mMeshes[0]->mNormals[i].z);
-    }
-    for (int i = 0; i < scene->mMeshes[0]->mNumFaces; ++i) {
-      if (scene->mMeshes[0]->mFaces[i].mNumIndices != 3) {
-        throw std::runtime_error("encountered non-triangle face");
+    // all triangle meshes in the scene are merged into one hierarchy with a submesh per mesh
+    for (int m = 0; m < scene->mNumMeshes; ++m) {
+      const aiMesh* mesh = scene->mMeshes[m];
+      if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) {
+        continue;
+      }
+      const auto baseVertex = static_cast<uint32_t>(vertices.size() / floatsPerVertex);
+      const size_t firstIndex = indices.size();
+      for (int i = 0; i < mesh->mNumVertices; ++i) {
+        vertices.push_back(mesh->mVertices[i].x);
+        vertices.push_back(mesh->mVertices[i].y);
+        vertices.push_back(mesh->mVertices[i].z);
+        vertices.push_back(mesh->mNormals[i].x);
+        vertices.push_back(mesh->mNormals[i].y);
+        vertices.push_back(mesh->mNormals[i].z);
       }
-      for (int j = 0; j < scene->mMeshes[0]->mFaces[i].mNumIndices; ++j) {
-        indices.push_back(scene->mMeshes[0]->mFaces[i].mIndices[j]);
+      for (int i = 0; i < mesh->mNumFaces; ++i) {
+        if (mesh->mFaces[i].mNumIndices != 3) {
+          throw std::runtime_error("encountered non-triangle face");
+        }
+        for (int j = 0; j < mesh->mFaces[i].mNumIndices; ++j) {
+          indices.push_back(baseVertex + mesh->mFaces[i].mIndices[j]);
+        }
       }
+      submeshes.push_back(trichi::Submesh{
+          .firstIndex = firstIndex,
+          .indexCount = indices.size() - firstIndex,
+          .materialId = mesh->mMaterialIndex,
+      });
     }
   }
   std::cout << "Loaded model from memory\n";
 
-  auto hierarchy = convertToJsObjec(trichi::buildClusterHierarchy(indices, vertices, vertexStride, params), true);
+  auto hierarchy = buildAndConvertClusterHierarchy(indices, submeshes, vertices, vertexStride, params);
 
   std::cout << "Generated triangle cluster hierarchy\n";
 
@@ -145,8 +229,16 @@ EMSCRIPTEN_BINDINGS(trichi) {
     .field("clusterConeWeight", &trichi::Params::clusterConeWeight)
     .field("targetClustersPerGroup", &trichi::Params::targetClustersPerGroup)
     .field("maxHierarchyDepth", &trichi::Params::maxHierarchyDepth)
-    .field("threadPoolSize", &trichi::Params::threadPoolSize);
+    .field("threadPoolSize", &trichi::Params::threadPoolSize)
+    .field("seed", &trichi::Params::seed)
+    .field("deferClusterOptimization", &trichi::Params::deferClusterOptimization)
+    .field("partitionRegions", &trichi::Params::partitionRegions)
+    .field("sortClustersSpatially", &trichi::Params::sortClustersSpatially)
+    .field("timeLimitMilliseconds", &trichi::Params::timeLimitMilliseconds)
+    .field("memoryBudgetBytes", &trichi::Params::memoryBudgetBytes);
 
   emscripten::function("buildTriangleClusterHierarchy", &buildTriangleClusterHierarchy);
+  emscripten::function("buildMultiMaterialTriangleClusterHierarchy", &buildMultiMaterialTriangleClusterHierarchy);
   emscripten::function("buildTriangleClusterHierarchyFromFileBlob", &buildTriangleClusterHierarchyFromFileBlob);
+  emscripten::function("getCancellationToken", &getCancellationToken);
 }